@@ -0,0 +1,419 @@
+//
+// Created by newap on 10/19/2026.
+//
+// Microbenchmarks of the kernels: bit I/O, frequency counting, Huffman tree building and coding, the lz77
+// match finder, match length kernels of every instruction set and decoder, the LZW dictionary. Every kernel
+// runs on its own over synthetic data of every kind and several sizes, so it is profiled and tuned without
+// file I/O and the other stages
+//
+
+#include "../lib/huffman.hpp"
+#include "../lib/lz77.hpp"
+#include "../lib/lzw.hpp"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <random>
+
+/**
+ * Kinds of synthetic data
+ */
+enum kinds { RANDOM = 0, SKEWED = 1, REPETITIVE = 2, TEXT = 3 };
+
+const char *const KIND_NAMES[] = {"random", "skewed", "repetitive", "text"};
+
+/**
+ * Sizes of synthetic data
+ */
+const vector<int64_t> SIZES = {4 << 10, 64 << 10, 1 << 20};
+
+/**
+ * Window, lookahead and depth of the lz77 benchmarks
+ */
+const int WINDOW = 4096, LOOKAHEAD = 1024, DEPTH = 64;
+
+/**
+ * Distance of the compared bytes of the match kernel benchmarks
+ */
+const size_t MATCH_DISTANCE = 256;
+
+/**
+ * Word length of the LZW benchmarks
+ */
+const int WORD_LENGTH = 16;
+
+/**
+ * Generates synthetic data, the generator is seeded by the kind, so every run sees the same data
+ * @param kind kind of data
+ * @param size count of bytes
+ * @return the data
+ */
+static vector<uint8_t> generate(int kind, size_t size) {
+  mt19937_64 rng(kind + 1);
+  vector<uint8_t> data;
+  data.reserve(size);
+
+  switch (kind) {
+    case RANDOM:
+      while (data.size() < size)
+        data.push_back((uint8_t) rng());
+      break;
+
+    case SKEWED: {
+      // geometric distribution, about 3 bits of entropy per byte
+      geometric_distribution<int> dist(0.2);
+      while (data.size() < size)
+        data.push_back((uint8_t) dist(rng));
+      break;
+    }
+
+    case REPETITIVE: {
+      // a few random phrases repeated with rare mutations
+      vector<vector<uint8_t>> phrases(16);
+      for (auto &phrase: phrases) {
+        phrase.resize(16 + rng() % 240);
+        for (auto &ch: phrase)
+          ch = (uint8_t) rng();
+      }
+
+      while (data.size() < size) {
+        const vector<uint8_t> &phrase = phrases[rng() % phrases.size()];
+        data.insert(data.end(), phrase.begin(), phrase.end());
+
+        if (rng() % 8 == 0)
+          data.push_back((uint8_t) rng());
+      }
+      break;
+    }
+
+    case TEXT: {
+      // words of Zipf-like frequencies separated by spaces and punctuation
+      vector<string> words(2048);
+      for (auto &word: words) {
+        word.resize(1 + rng() % 3 + rng() % 6);
+        for (auto &ch: word)
+          ch = "etaoinshrdlucmfwypvbgkjqxz"[min<uint64_t>(rng() % 26, rng() % 26)];
+      }
+
+      uniform_real_distribution<double> dist(0, 1);
+      while (data.size() < size) {
+        const string &word = words[(size_t) (words.size() * pow(dist(rng), 3))];
+        data.insert(data.end(), word.begin(), word.end());
+        data.push_back(rng() % 16 ? ' ' : rng() % 2 ? '.' : '\n');
+      }
+      break;
+    }
+
+    default:
+      error("Invalid kind of data.");
+  }
+
+  data.resize(size);
+
+  return data;
+}
+
+/**
+ * Returns synthetic data generated once per kind and size
+ * @param state state of the benchmark, its arguments are the kind and the size
+ * @return the data
+ */
+static const vector<uint8_t> &getData(benchmark::State &state) {
+  static map<pair<int, int64_t>, vector<uint8_t>> cache;
+
+  int kind = (int) state.range(0);
+  int64_t size = state.range(1);
+
+  state.SetLabel(KIND_NAMES[kind]);
+
+  auto it = cache.find({kind, size});
+  if (it == cache.end())
+    it = cache.emplace(make_pair(kind, size), generate(kind, size)).first;
+
+  return it->second;
+}
+
+/**
+ * Sets the count of processed bytes
+ * @param state state of the benchmark
+ * @param size bytes per iteration
+ */
+static void setBytes(benchmark::State &state, size_t size) {
+  state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) size);
+}
+
+/**
+ * Lengths of the written and read values, from 1 to 16 bits
+ * @param data data
+ * @return the lengths
+ */
+static vector<int> getLengths(const vector<uint8_t> &data) {
+  vector<int> lengths(data.size());
+
+  for (size_t i = 0; i < data.size(); i++)
+    lengths[i] = 1 + (data[i] ^ (int) i) % 16;
+
+  return lengths;
+}
+
+static void BM_obitbuf_write(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  vector<int> lengths = getLengths(data);
+  vector<uint8_t> out(data.size() * 2 + 8);
+
+  for (auto _: state) {
+    obitbuf bout(out);
+
+    for (size_t i = 0; i < data.size(); i++)
+      bout.writeData(data[i] * 0x0101u, lengths[i]);
+
+    benchmark::DoNotOptimize(bout.flush());
+  }
+
+  setBytes(state, data.size());
+}
+
+static void BM_ibitbuf_read(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  vector<int> lengths = getLengths(data);
+  vector<uint8_t> out(data.size() * 2 + 8);
+
+  obitbuf bout(out);
+  for (size_t i = 0; i < data.size(); i++)
+    bout.writeData(data[i] * 0x0101u, lengths[i]);
+  out.resize(bout.flush());
+
+  for (auto _: state) {
+    ibitbuf bin(out);
+    uint64_t sum = 0;
+
+    for (const int &length: lengths)
+      sum += bin.readData(length);
+
+    benchmark::DoNotOptimize(sum);
+  }
+
+  setBytes(state, data.size());
+}
+
+static void BM_getFrequencies(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  huffman arch;
+
+  for (auto _: state)
+    benchmark::DoNotOptimize(arch.getFrequencies(data));
+
+  setBytes(state, data.size());
+}
+
+static void BM_huffman_tree(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  huffman arch;
+  huffman::context ctx;
+
+  arch.getFrequencyTable(ctx, data);
+
+  for (auto _: state) {
+    arch.buildEncodingTree(ctx);
+    benchmark::DoNotOptimize(ctx.tree.root);
+  }
+}
+
+template<bool interleaved>
+static void BM_huffman_encode(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  huffman arch(interleaved);
+  huffman::context ctx;
+  vector<uint8_t> out(arch.compressBound(data.size()));
+
+  for (auto _: state)
+    benchmark::DoNotOptimize(arch.compress(ctx, data, out));
+
+  setBytes(state, data.size());
+}
+
+template<bool interleaved>
+static void BM_huffman_decode(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  huffman arch(interleaved);
+  huffman::context ctx;
+  vector<uint8_t> compressed(arch.compressBound(data.size()));
+  vector<uint8_t> out(data.size());
+
+  compressed.resize(arch.compress(ctx, data, compressed));
+
+  for (auto _: state) {
+    obytebuf bout(out);
+    arch.decompress(ctx, compressed, bout);
+    benchmark::DoNotOptimize(bout.size());
+  }
+
+  setBytes(state, data.size());
+}
+
+static void BM_lz77_find(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  lz77context ctx;
+
+  // the parse of the kernel without coding the triplets
+  for (auto _: state) {
+    ctx.reset(WINDOW);
+
+    for (size_t i = 0; i < data.size(); i++) {
+      Triplet triplet = ctx.find(i, data, WINDOW, LOOKAHEAD, DEPTH);
+
+      for (uint64_t p = i; p <= i + triplet.k; p++)
+        ctx.insert(p, data);
+
+      i += triplet.k;
+    }
+
+    benchmark::DoNotOptimize(ctx.head.data());
+  }
+
+  setBytes(state, data.size());
+}
+
+template<cpu::level L>
+static void BM_matchLength(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  cpu::matchkernel kernel = cpu::getMatch(L);
+
+  if (L > cpu::selected) {
+    state.SkipWithError("instruction set is not supported");
+    return;
+  }
+
+  // the data compared with itself at a fixed distance, the next comparison starts after the difference
+  for (auto _: state) {
+    size_t total = 0;
+
+    for (size_t i = MATCH_DISTANCE; i < data.size(); i++) {
+      size_t length = kernel(&data[i - MATCH_DISTANCE], &data[i], min<size_t>(LOOKAHEAD, data.size() - i));
+      total += length;
+      i += length;
+    }
+
+    benchmark::DoNotOptimize(total);
+  }
+
+  setBytes(state, data.size());
+}
+
+static void BM_lz77_decode(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  lz77<WINDOW, LOOKAHEAD> arch(DEPTH);
+  vector<uint8_t> compressed(arch.compressBound(data.size()));
+  vector<uint8_t> out(data.size());
+
+  compressed.resize(arch.compress(data, compressed));
+
+  for (auto _: state) {
+    obytebuf bout(out);
+    arch.decompress(compressed, bout);
+    benchmark::DoNotOptimize(bout.size());
+  }
+
+  setBytes(state, data.size());
+}
+
+/**
+ * Parses the data by the compression dictionary of LZW
+ * @param ctx context
+ * @param data data
+ * @param insert if true, new words are inserted, otherwise they are only looked up
+ * @return count of codes
+ */
+static size_t parseLzw(lzw::context &ctx, const vector<uint8_t> &data, bool insert) {
+  const unsigned int maxSize = 1 << (WORD_LENGTH - 1);
+  uint32_t curr = data[0];
+  unsigned int ind = MAX_CHAR + 1;
+  size_t codes = 0, index;
+
+  for (size_t i = 1; i < data.size(); i++) {
+    uint32_t key = (curr << BYTE_SIZE) | data[i];
+
+    if (ctx.find(key, index)) {
+      curr = ctx.cells[index].code;
+      continue;
+    }
+
+    if (insert && ind <= maxSize)
+      ctx.cells[index] = {key, ind++, ctx.stamp};
+
+    codes++;
+    curr = data[i];
+  }
+
+  return codes;
+}
+
+static void BM_lzw_insert(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  lzw::context ctx;
+
+  for (auto _: state) {
+    ctx.resetCompression(1 << (WORD_LENGTH - 1));
+    benchmark::DoNotOptimize(parseLzw(ctx, data, true));
+  }
+
+  setBytes(state, data.size());
+}
+
+static void BM_lzw_lookup(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  lzw::context ctx;
+
+  ctx.resetCompression(1 << (WORD_LENGTH - 1));
+  parseLzw(ctx, data, true);
+
+  for (auto _: state)
+    benchmark::DoNotOptimize(parseLzw(ctx, data, false));
+
+  setBytes(state, data.size());
+}
+
+static void BM_lzw_decode(benchmark::State &state) {
+  const vector<uint8_t> &data = getData(state);
+  lzw arch(WORD_LENGTH);
+  lzw::context ctx;
+  vector<uint8_t> compressed(arch.compressBound(data.size()));
+  vector<uint8_t> out(data.size());
+
+  compressed.resize(arch.compress(ctx, data, compressed));
+
+  for (auto _: state) {
+    obytebuf bout(out);
+    arch.decompress(ctx, compressed, bout);
+    benchmark::DoNotOptimize(bout.size());
+  }
+
+  setBytes(state, data.size());
+}
+
+/**
+ * Runs the benchmark on every kind of data and every size
+ * @param bench benchmark
+ */
+static void allData(benchmark::internal::Benchmark *bench) {
+  bench->ArgNames({"kind", "size"});
+  bench->ArgsProduct({{RANDOM, SKEWED, REPETITIVE, TEXT}, SIZES});
+}
+
+BENCHMARK(BM_obitbuf_write)->Apply(allData);
+BENCHMARK(BM_ibitbuf_read)->Apply(allData);
+BENCHMARK(BM_getFrequencies)->Apply(allData);
+BENCHMARK(BM_huffman_tree)->Apply(allData);
+BENCHMARK_TEMPLATE(BM_huffman_encode, false)->Apply(allData);
+BENCHMARK_TEMPLATE(BM_huffman_encode, true)->Apply(allData);
+BENCHMARK_TEMPLATE(BM_huffman_decode, false)->Apply(allData);
+BENCHMARK_TEMPLATE(BM_huffman_decode, true)->Apply(allData);
+BENCHMARK(BM_lz77_find)->Apply(allData);
+BENCHMARK_TEMPLATE(BM_matchLength, cpu::BASELINE)->Apply(allData);
+BENCHMARK_TEMPLATE(BM_matchLength, cpu::SSE42)->Apply(allData);
+BENCHMARK_TEMPLATE(BM_matchLength, cpu::AVX2)->Apply(allData);
+BENCHMARK(BM_lz77_decode)->Apply(allData);
+BENCHMARK(BM_lzw_insert)->Apply(allData);
+BENCHMARK(BM_lzw_lookup)->Apply(allData);
+BENCHMARK(BM_lzw_decode)->Apply(allData);
+
+BENCHMARK_MAIN();
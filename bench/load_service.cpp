@@ -0,0 +1,155 @@
+//
+// Created by newap on 10/19/2026.
+//
+// Load generator of the compression service: client threads submit buffers as fast as the bounded queue
+// takes them, every compressed buffer is decompressed by the service again and compared with the original.
+// Queue depth, throughput and latency quantiles are printed every second and at the end
+//
+// Usage: load_service [threads [clients [jobs [size [level [capacity]]]]]]
+//
+
+#include "../lib/levels.hpp"
+#include "../lib/service.hpp"
+#include <atomic>
+#include <cstdio>
+#include <random>
+
+/**
+ * Count of jobs of every client waiting for their results
+ */
+const size_t OUTSTANDING = 8;
+
+/**
+ * Generates text-like buffer of words from a small vocabulary, seeded by the job
+ * @param seed seed
+ * @param size count of bytes
+ * @return the buffer
+ */
+static vector<uint8_t> generate(uint64_t seed, size_t size) {
+  static const char *const WORDS[] = {"the ", "archive ", "block ", "of ", "compressed ", "stream ", "and ",
+                                      "window ", "match ", "a ", "queue ", "worker ", "\n", "level ", "to "};
+  mt19937_64 rng(seed);
+  vector<uint8_t> data;
+  data.reserve(size + 16);
+
+  while (data.size() < size) {
+    const char *word = WORDS[rng() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+    data.insert(data.end(), word, word + strlen(word));
+
+    if (rng() % 16 == 0)
+      data.push_back((uint8_t) rng());
+  }
+
+  data.resize(size);
+
+  return data;
+}
+
+/**
+ * Prints the counters of the service
+ * @param name name of the line
+ * @param s counters
+ */
+static void printStats(const char *name, const service::stats &s) {
+  printf("%-6s %7.1fs  depth %3zu (max %3zu)  jobs %8llu  failed %4llu  %8.1f MB/s"
+         "  latency p50 %8.0f us  p99 %8.0f us\n",
+         name, s.seconds, s.depth, s.maxDepth, (unsigned long long) s.completed, (unsigned long long) s.failed,
+         s.getThroughput(), s.getLatency(0.5), s.getLatency(0.99));
+  fflush(stdout);
+}
+
+/**
+ * Parses the argument or returns the default
+ * @param argc count of arguments
+ * @param argv arguments
+ * @param index index of the argument
+ * @param value default value
+ * @return the value
+ */
+static size_t getArgument(int argc, char **argv, int index, size_t value) {
+  return index < argc ? stoull(argv[index]) : value;
+}
+
+/**
+ * Main entry point
+ * @param argc count of arguments
+ * @param argv arguments
+ * @return exit code
+ */
+int main(int argc, char **argv) {
+  try {
+    unsigned int threads = getArgument(argc, argv, 1, 0);
+    size_t clients = getArgument(argc, argv, 2, 4);
+    size_t jobs = getArgument(argc, argv, 3, 200);
+    size_t size = getArgument(argc, argv, 4, 256 << 10);
+    int level = getArgument(argc, argv, 5, 3);
+    size_t capacity = getArgument(argc, argv, 6, 16);
+
+    service svc([&]() { return new levels(level); }, threads, capacity);
+
+    printf("workers %u, clients %zu, jobs %zu per client, %zu bytes, level %d, queue %zu\n",
+           svc.getThreads(), clients, jobs, size, level, capacity);
+
+    atomic<bool> running{true};
+    atomic<uint64_t> mismatches{0};
+
+    thread reporter([&]() {
+      while (running) {
+        this_thread::sleep_for(chrono::seconds(1));
+        printStats("load", svc.getStats());
+      }
+    });
+
+    vector<thread> producers;
+
+    for (size_t c = 0; c < clients; c++) {
+      producers.emplace_back([&, c]() {
+        deque<pair<vector<uint8_t>, future<vector<uint8_t>>>> pending;
+
+        // the original is kept until the decompressed buffer is compared with it
+        auto check = [&]() {
+          auto &front = pending.front();
+
+          try {
+            future<vector<uint8_t>> restored = svc.decompress(front.second.get());
+
+            if (restored.get() != front.first)
+              mismatches++;
+          } catch (const exception &) {
+            mismatches++;
+          }
+
+          pending.pop_front();
+        };
+
+        for (size_t j = 0; j < jobs; j++) {
+          vector<uint8_t> data = generate(c * jobs + j, size);
+          future<vector<uint8_t>> compressed = svc.compress(data);
+          pending.emplace_back(move(data), move(compressed));
+
+          if (pending.size() >= OUTSTANDING)
+            check();
+        }
+
+        while (!pending.empty())
+          check();
+      });
+    }
+
+    for (auto &producer: producers)
+      producer.join();
+
+    running = false;
+    reporter.join();
+
+    printStats("total", svc.getStats());
+
+    if (mismatches > 0)
+      error(to_string(mismatches.load()) + " buffers were not restored.");
+  } catch (const exception &e) {
+    fprintf(stderr, "load_service: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,78 @@
+//
+// Created by newap on 10/19/2026.
+//
+// Fuzzing target of the decoders: the first byte of the input chooses the archiver, the rest is decompressed
+// into a fixed buffer, so invalid streams may only raise exceptions. Built by libFuzzer with Clang,
+// other compilers build a driver which runs the target on the files given as arguments
+//
+
+#include "../lib/autoarchiver.hpp"
+#include "../lib/bwt.hpp"
+#include "../lib/container.hpp"
+#include "../lib/ctxhuffman.hpp"
+#include "../lib/dedup.hpp"
+#include "../lib/filter.hpp"
+#include "../lib/huffman.hpp"
+#include "../lib/levels.hpp"
+#include "../lib/lz77.hpp"
+#include "../lib/lz77long.hpp"
+#include "../lib/lzw.hpp"
+
+/**
+ * Maximal size of the decompressed data
+ */
+const size_t MAX_OUTPUT_SIZE = 1 << 22;
+
+/**
+ * Gets and returns archivers
+ * @return archivers
+ */
+static vector<unique_ptr<archiver>> getArchivers() {
+  vector<unique_ptr<archiver>> archivers;
+
+  archivers.emplace_back(new huffman());
+  archivers.emplace_back(new huffman(true));
+  archivers.emplace_back(new lz77<4096, 1024>());
+  archivers.emplace_back(new lz77dyn(4096, 1024));
+  archivers.emplace_back(new lz77long(1 << 20));
+  archivers.emplace_back(new lzw(16));
+  archivers.emplace_back(new dedup(new lz77dyn(4096, 1024)));
+  archivers.emplace_back(new autoarchiver());
+  archivers.emplace_back(new bwt());
+  archivers.emplace_back(new filter(new lzw(16)));
+  archivers.emplace_back(new ctxhuffman());
+  archivers.emplace_back(new levels());
+  archivers.emplace_back(new container());
+
+  return archivers;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static vector<unique_ptr<archiver>> archivers = getArchivers();
+  static vector<uint8_t> output(MAX_OUTPUT_SIZE);
+
+  if (size == 0)
+    return 0;
+
+  archiver &arch = *archivers[data[0] % archivers.size()];
+
+  try {
+    arch.decompress(span<const uint8_t>(data + 1, size - 1), span<uint8_t>(output));
+  } catch (const exception &) {
+  }
+
+  return 0;
+}
+
+#ifndef HW_ARCHIVER_LIBFUZZER
+int main(int argc, char **argv) {
+  huffman reader;
+
+  for (int i = 1; i < argc; i++) {
+    vector<uint8_t> contents = reader.getContents(string(argv[i]));
+    LLVMFuzzerTestOneInput(contents.data(), contents.size());
+  }
+
+  return 0;
+}
+#endif
@@ -8,11 +8,91 @@
 #include "types.h"
 #include "bitbuf.hpp"
 #include "utils.h"
+#include "checksum.hpp"
 #include <map>
+#include <unordered_map>
 #include <queue>
 #include <sstream>
 #include <cmath>
 
+/**
+ * Stream buffer which checks decompressed bytes as they are written instead of storing them: it counts them,
+ * adds them to the xxHash64 checksum and, if the original is given, compares them with the original read by
+ * chunks of the same size. Nothing is written, so the memory is bounded by the decoder's window for the decoders
+ * which stream through decompressWindowed (lz77, lz77dyn, lz77long, lzw) and for the blocks in flight of pipeline
+ * (container's levels, auto and bwt); other decoders still hold the whole input and output
+ */
+class verifybuf : public streambuf {
+ public:
+  /**
+   * Default constructor
+   * @param original stream of the original or nullptr to only count and hash the bytes
+   */
+  explicit verifybuf(istream *original = nullptr) : _original(original) {
+  }
+
+  /**
+   * Returns count of the written bytes
+   * @return count of bytes
+   */
+  uint64_t getSize() const {
+    return _size;
+  }
+
+  /**
+   * Returns the checksum of the written bytes
+   * @return xxHash64 checksum
+   */
+  uint64_t getChecksum() const {
+    return _hash.digest();
+  }
+
+  /**
+   * Checks if the written bytes are the whole original
+   * @return true if they match and false otherwise
+   */
+  bool matches() {
+    return _matches && _original && _original->peek() == char_traits<char>::eof();
+  }
+
+ protected:
+  int overflow(int ch) override {
+    if (ch != EOF) {
+      char c = (char) ch;
+      xsputn(&c, 1);
+    }
+
+    return ch == EOF ? 0 : ch;
+  }
+
+  streamsize xsputn(const char *s, streamsize n) override {
+    span<const uint8_t> data((const uint8_t *) s, n);
+
+    _size += n;
+    _hash.update(data);
+
+    // after the first difference the original is not read anymore
+    for (streamsize done = 0; _original && _matches && done < n;) {
+      streamsize size = min<streamsize>(n - done, CHUNK_SIZE);
+      _original->read((char *) _chunk.data(), size);
+      _matches = _original->gcount() == size && memcmp(_chunk.data(), s + done, size) == 0;
+      done += size;
+    }
+
+    return n;
+  }
+
+ private:
+  static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+  istream *_original;
+  vector<uint8_t> _chunk = vector<uint8_t>(CHUNK_SIZE);
+
+  xxhash64 _hash;
+  uint64_t _size{0};
+  bool _matches{true};
+};
+
 /**
  * Abstract class for archivers
  */
@@ -24,15 +104,103 @@ class archiver {
    * @param twoContents second file's contents
    * @return true if they match and false otherwise
    */
-  bool compareFiles(const vector<uint8_t> &oneContents, const vector<uint8_t> &twoContents) {
-    if (oneContents.size() != twoContents.size())
+  bool compareFiles(span<const uint8_t> oneContents, span<const uint8_t> twoContents) {
+    return oneContents.size() == twoContents.size()
+        && (oneContents.empty() || memcmp(oneContents.data(), twoContents.data(), oneContents.size()) == 0);
+  }
+
+  /**
+   * Compares files by chunks without reading them whole, sizes are compared first
+   * @param oneFilename first file's name
+   * @param twoFilename second file's name
+   * @return true if they match and false otherwise
+   */
+  bool compareFiles(const string &oneFilename, const string &twoFilename) {
+    if (getSize(oneFilename) != getSize(twoFilename))
+      return false;
+
+    ifstream one(oneFilename, ios::in | ios::binary);
+    ifstream two(twoFilename, ios::in | ios::binary);
+
+    if (!one || !two)
       return false;
 
-    for (int i = 0; i < oneContents.size(); i++)
-      if (oneContents[i] != twoContents[i])
+    vector<uint8_t> oneChunk(1 << 16), twoChunk(1 << 16);
+
+    while (one && two) {
+      one.read((char *) oneChunk.data(), oneChunk.size());
+      two.read((char *) twoChunk.data(), twoChunk.size());
+
+      if (one.gcount() != two.gcount()
+          || !compareFiles(span<const uint8_t>(oneChunk.data(), one.gcount()),
+                           span<const uint8_t>(twoChunk.data(), two.gcount())))
         return false;
+    }
+
+    return one.eof() && two.eof();
+  }
+
+  /**
+   * Checks contents by its xxHash64 checksum, so the original does not have to be kept
+   * @param contents contents
+   * @param checksum expected checksum
+   * @return true if they match and false otherwise
+   */
+  bool compareChecksum(span<const uint8_t> contents, uint64_t checksum) {
+    return xxhash64::hash(contents) == checksum;
+  }
+
+  /**
+   * Decompresses file and compares it with the original without writing the decompressed contents,
+   * the stream operation's decoder writes them to verifybuf, whose memory bound holds only for the streaming
+   * decoders. Damaged archives do not match
+   * @param compressedFilename compressed file's name
+   * @param originalFilename original file's name
+   * @return true if they match and false otherwise
+   */
+  bool verify(const string &compressedFilename, const string &originalFilename) {
+    ifstream in(compressedFilename, ios::in | ios::binary);
+    ifstream original(originalFilename, ios::in | ios::binary);
+
+    if (!in || !original)
+      return false;
+
+    verifybuf sink(&original);
+    ostream out(&sink);
+
+    // damaged archives differ from the original, their decoders' errors are not passed to the caller
+    try {
+      decompress(in, out);
+    } catch (const exception &) {
+      return false;
+    }
+
+    return sink.matches();
+  }
+
+  /**
+   * Decompresses file and checks it by the xxHash64 checksum of the original without writing the decompressed
+   * contents
+   * @param compressedFilename compressed file's name
+   * @param checksum expected checksum
+   * @return true if they match and false otherwise
+   */
+  bool verify(const string &compressedFilename, uint64_t checksum) {
+    ifstream in(compressedFilename, ios::in | ios::binary);
+
+    if (!in)
+      return false;
+
+    verifybuf sink;
+    ostream out(&sink);
+
+    try {
+      decompress(in, out);
+    } catch (const exception &) {
+      return false;
+    }
 
-    return true;
+    return sink.getChecksum() == checksum;
   }
 
   /**
@@ -54,19 +222,35 @@ class archiver {
    * @return contents from the stream
    */
   vector<uint8_t> getContents(istream &in) {
-    auto begin = istreambuf_iterator<char>(in);
-    auto end = istreambuf_iterator<char>();
+    vector<uint8_t> contents;
+    getContents(in, contents);
 
-    vector<uint8_t> contents(begin, end);
     return contents;
   }
 
+  /**
+   * Reads contents from the stream to the vector, its capacity is reused
+   * @param in stream
+   * @param contents contents from the stream
+   */
+  void getContents(istream &in, vector<uint8_t> &contents) {
+    size_t size = 0;
+
+    do {
+      contents.resize(max<size_t>({size * 2, contents.capacity(), 1 << 16}));
+      in.read((char *) contents.data() + size, contents.size() - size);
+      size += in.gcount();
+    } while (in);
+
+    contents.resize(size);
+  }
+
   /**
    * Counts and returns the frequencies list from contents
    * @param contents contents
    * @return the frequencies list from contents
    */
-  vector<int> getFrequencies(const vector<uint8_t> &contents) {
+  vector<int> getFrequencies(span<const uint8_t> contents) {
     vector<int> freqs(MAX_CHAR, 0);
 
     for (const uint8_t &ch: contents)
@@ -81,10 +265,9 @@ class archiver {
    * @return the file size
    */
   size_t getSize(const string &filename) {
-    vector<uint8_t> contents = getContents(filename);
+    ifstream fin(filename, ios::in | ios::binary | ios::ate);
 
-    size_t size = contents.size();
-    return size;
+    return fin ? (size_t) fin.tellg() : 0;
   }
 
   /**
@@ -101,7 +284,17 @@ class archiver {
 
     freqs = getFrequencies(contents);
 
-    entropy = 0;
+    entropy = getEntropy(freqs.data(), size);
+  }
+
+  /**
+   * Counts and returns entropy (in bytes per byte, from 0 to 1) from frequencies list
+   * @param freqs frequencies list of MAX_CHAR elements
+   * @param size count of bytes
+   * @return entropy
+   */
+  static double getEntropy(const int *freqs, size_t size) {
+    double entropy = 0;
 
     for (int i = 0; i < MAX_CHAR; i++) {
       if (freqs[i] != 0) {
@@ -109,6 +302,8 @@ class archiver {
           entropy -= p_x * log(p_x) / log(256);
       }
     }
+
+    return entropy;
   }
 
   /**
@@ -146,14 +341,121 @@ class archiver {
    * @param in stream to compress
    * @param out compressed stream
    */
-  virtual void compress(istream &in, ostream &out) = 0;
+  virtual void compress(istream &in, ostream &out) {
+    getContents(in, _input);
+    _output.resize(compressBound(_input.size()));
+
+    size_t size = compress(_input, _output);
+    out.write((const char *) _output.data(), size);
+  }
 
   /**
    * Decompress stream
    * @param in stream to decompress
    * @param out decompressed stream
    */
-  virtual void decompress(istream &in, ostream &out) = 0;
+  virtual void decompress(istream &in, ostream &out) {
+    getContents(in, _input);
+
+    decompress(_input, _output);
+    out.write((const char *) _output.data(), _output.size());
+  }
+
+  /**
+   * Decompress buffer to a buffer of known size
+   * @param in buffer to decompress
+   * @param out buffer for decompressed data, must be large enough
+   * @return count of decompressed bytes
+   */
+  size_t decompress(span<const uint8_t> in, span<uint8_t> out) {
+    obytebuf bout(out);
+    decompress(in, bout);
+    return bout.size();
+  }
+
+  /**
+   * Decompress buffer to a vector which grows as needed
+   * @param in buffer to decompress
+   * @param out vector for decompressed data
+   */
+  void decompress(span<const uint8_t> in, vector<uint8_t> &out) {
+    obytebuf bout(out);
+    decompress(in, bout);
+  }
+
+  /**
+   * Counts and returns the maximal compressed size of the data with given size
+   * @param size size of the data
+   * @return the maximal compressed size
+   */
+  virtual size_t compressBound(size_t size) = 0;
+
+  /**
+   * Compress buffer
+   * @param in buffer to compress
+   * @param out buffer for compressed data, at least compressBound(in.size()) bytes
+   * @return count of compressed bytes
+   */
+  virtual size_t compress(span<const uint8_t> in, span<uint8_t> out) = 0;
+
+  /**
+   * Decompress buffer
+   * @param in buffer to decompress
+   * @param out output for decompressed data
+   */
+  virtual void decompress(span<const uint8_t> in, obytebuf &out) = 0;
+
+  /**
+   * Compress the end of the buffer, its beginning is the history which the stream may reference, so the stream
+   * is decompressed only after the history. Archivers without matches or dictionaries compress the end alone
+   * @param in buffer with the history and the data
+   * @param primed count of bytes of the history
+   * @param out buffer for compressed data, at least compressBound(in.size() - primed) bytes
+   * @return count of compressed bytes
+   */
+  virtual size_t compress(span<const uint8_t> in, size_t primed, span<uint8_t> out) {
+    return compress(in.subspan(primed), out);
+  }
+
+  /**
+   * Decompress buffer compressed after the history
+   * @param in buffer to decompress
+   * @param primed count of the last bytes of the output which are the history
+   * @param out output for decompressed data, holds the history
+   */
+  virtual void decompress(span<const uint8_t> in, size_t /*primed*/, obytebuf &out) {
+    decompress(in, out);
+  }
+
+  /**
+   * Returns count of the last bytes of the history which streams may reference
+   * @return count of bytes, 0 if streams do not reference the history
+   */
+  virtual size_t getHistorySize() {
+    return 0;
+  }
+
+  virtual ~archiver() = default;
+
+ protected:
+  /**
+   * Buffers of the stream operations, kept between calls
+   */
+  vector<uint8_t> _input, _output;
+
+  /**
+   * Decompress stream through the window of obytebuf, which writes the decompressed bytes as soon as the decoder
+   * does not reach them anymore, for decoders which only append bytes and copy matches
+   * @param in stream to decompress
+   * @param out decompressed stream
+   */
+  void decompressWindowed(istream &in, ostream &out) {
+    getContents(in, _input);
+
+    obytebuf bout(out);
+    decompress(_input, bout);
+    bout.flush();
+  }
 };
 
 #endif //HW_ARCHIVER_LIB_ARCHIVER_H_
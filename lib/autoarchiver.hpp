@@ -0,0 +1,272 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_AUTOARCHIVER_HPP_
+#define HW_ARCHIVER_LIB_AUTOARCHIVER_HPP_
+
+#include "blockwise.hpp"
+#include "huffman.hpp"
+#include "lz77.hpp"
+#include "lzw.hpp"
+
+/**
+ * Archiver which chooses the codec for every block by estimating the compressed sizes on samples:
+ * huffman by the entropy, lz77 by the density of matches found by a greedy parse, lzw by the growth of its
+ * dictionary. Among the codecs whose relative CPU cost fits the budget the smallest estimate wins,
+ * a cheaper codec is kept if it is almost as good. The choice is written to the block's header
+ */
+class autoarchiver : public blockwise {
+ public:
+  /**
+   * Indices of the codecs
+   */
+  enum codecs { HUFFMAN = 0, LZ77 = 1, LZW = 2, CODECS_COUNT = 3 };
+
+  /**
+   * Relative CPU cost of every codec per byte, huffman's cost is 1
+   */
+  static constexpr double COSTS[CODECS_COUNT] = {1, 16, 4};
+
+  /**
+   * Size of every sample
+   */
+  static constexpr size_t SAMPLE_SIZE = 32 * 1024;
+
+  /**
+   * Count of samples of every block
+   */
+  static constexpr size_t SAMPLES = 4;
+
+  /**
+   * Default constructor
+   * @param budget maximal relative CPU cost of the codec (huffman's cost is 1)
+   * @param blockSize size of blocks
+   * @param threshold sampled entropy (from 0 to 1) from which blocks are stored without trying to compress
+   */
+  explicit autoarchiver(double budget = COSTS[LZ77], size_t blockSize = 1 << 20, double threshold = 0.98)
+      : blockwise(blockSize, threshold) {
+    _budget = budget;
+
+    _codecs.emplace_back(new huffman());
+    _codecs.emplace_back(new lz77dyn(LZ77_WINDOW, LZ77_LOOKAHEAD));
+    _codecs.emplace_back(new lzw(LZW_WORD_LENGTH));
+
+    _positions.resize(1 << HASH_BITS);
+    _keys.resize(2 << LZW_WORD_LENGTH);
+    _stamps.resize(2 << LZW_WORD_LENGTH);
+  }
+
+  /**
+   * Estimates compressed sizes of the block for every codec
+   * @param block block
+   * @param estimates estimated compressed sizes in bytes
+   */
+  void estimate(span<const uint8_t> block, double (&estimates)[CODECS_COUNT]) {
+    int freqs[MAX_CHAR] = {};
+    size_t sampled = 0, counted = 0;
+    double lz77Bits = 0, lzwBits = 0;
+
+    resetDictionary();
+
+    for (size_t k = 0; k < SAMPLES; k++) {
+      span<const uint8_t> sample = getSample(block, k);
+
+      if (sample.empty())
+        continue;
+
+      for (const uint8_t &ch: sample)
+        freqs[ch]++;
+
+      // the first half of the sample only fills the window and the dictionary
+      size_t warmup = sample.size() / 2;
+
+      sampled += sample.size();
+      counted += sample.size() - warmup;
+      lz77Bits += (double) countTriplets(sample, warmup) * LZ77_TRIPLET_BITS;
+      lzwBits += (double) countCodes(sample, warmup) * LZW_WORD_LENGTH;
+    }
+
+    double scale = counted ? (double) block.size() / counted : 0;
+
+    // huffman's header is at most 12 bytes per symbol
+    estimates[HUFFMAN] = sampled ? getEntropy(freqs, sampled) * block.size() + 12 * MAX_CHAR : 0;
+    estimates[LZ77] = lz77Bits / BYTE_SIZE * scale;
+    estimates[LZW] = lzwBits / BYTE_SIZE * scale;
+  }
+
+ protected:
+  int chooseCodec(span<const uint8_t> block) override {
+    if (sampleEntropy(block) >= _threshold)
+      return -1;
+
+    double estimates[CODECS_COUNT];
+    estimate(block, estimates);
+
+    int best = -1;
+    for (int i = 0; i < CODECS_COUNT; i++)
+      if (COSTS[i] <= _budget && (best < 0 || estimates[i] < estimates[best]))
+        best = i;
+
+    if (best < 0)
+      return HUFFMAN;
+
+    // a cheaper codec is kept if it loses less than 2% of the block
+    int chosen = best;
+    for (int i = 0; i < CODECS_COUNT; i++)
+      if (COSTS[i] < COSTS[chosen] && estimates[i] <= estimates[best] + 0.02 * block.size())
+        chosen = i;
+
+    return estimates[chosen] < block.size() ? chosen : -1;
+  }
+
+ private:
+  /**
+   * Parameters of the codecs
+   */
+  static constexpr unsigned int LZ77_WINDOW = 16 * 1024;
+  static constexpr unsigned int LZ77_LOOKAHEAD = 4 * 1024;
+  static constexpr unsigned int LZ77_TRIPLET_BITS = countBits(LZ77_WINDOW - 1) + countBits(LZ77_LOOKAHEAD) + 8;
+  static constexpr int LZW_WORD_LENGTH = 16;
+  static constexpr size_t LZW_DICTIONARY_SIZE = ((size_t) 1 << (LZW_WORD_LENGTH - 1)) - MAX_CHAR;
+
+  /**
+   * Count of bits of the match finder's hash
+   */
+  static constexpr unsigned int HASH_BITS = 12;
+
+  /**
+   * Maximal relative CPU cost of the codec
+   */
+  double _budget;
+
+  /**
+   * Last positions of the match finder's hash values
+   */
+  vector<int32_t> _positions;
+
+  /**
+   * Dictionary of the lzw simulation: open addressing table of (prefix code << 8) | byte
+   */
+  vector<uint32_t> _keys;
+
+  /**
+   * Cell of the dictionary is used only if its stamp equals to the current one
+   */
+  vector<uint32_t> _stamps;
+
+  /**
+   * Current stamp of the dictionary
+   */
+  uint32_t _stamp{0};
+
+  /**
+   * Count of words in the dictionary
+   */
+  size_t _words{0};
+
+  /**
+   * Returns evenly spaced sample of the block
+   * @param block block
+   * @param k index of the sample
+   * @return the sample, whole block for the first sample of small blocks and empty for others
+   */
+  static span<const uint8_t> getSample(span<const uint8_t> block, size_t k) {
+    if (block.size() <= SAMPLE_SIZE * SAMPLES)
+      return k == 0 ? block : span<const uint8_t>();
+
+    return block.subspan(k * (block.size() - SAMPLE_SIZE) / (SAMPLES - 1), SAMPLE_SIZE);
+  }
+
+  /**
+   * Counts triplets of the greedy parse with matches of at least 3 bytes, the density of matches
+   * @param sample sample
+   * @param warmup count of the first bytes which are parsed but not counted
+   * @return count of triplets
+   */
+  size_t countTriplets(span<const uint8_t> sample, size_t warmup) {
+    fill(_positions.begin(), _positions.end(), -1);
+
+    const int64_t n = sample.size();
+    size_t triplets = 0;
+
+    for (int64_t i = 0; i < n;) {
+      int64_t len = 0;
+
+      if (i + 3 < n) {
+        uint32_t h = ((sample[i] | (sample[i + 1] << 8) | (sample[i + 2] << 16)) * 0x9E3779B1u) >> (32 - HASH_BITS);
+        int64_t cand = _positions[h];
+        _positions[h] = i;
+
+        if (cand >= 0 && i - cand <= LZ77_WINDOW) {
+          int64_t lend = min<int64_t>(LZ77_LOOKAHEAD, n - 1 - i);
+          while (len < lend && sample[cand + len] == sample[i + len])
+            len++;
+
+          if (len < 3)
+            len = 0;
+        }
+      }
+
+      if (i >= (int64_t) warmup)
+        triplets++;
+
+      i += len + 1;
+    }
+
+    return triplets;
+  }
+
+  /**
+   * Forgets all words of the lzw simulation
+   */
+  void resetDictionary() {
+    if (++_stamp == 0) {
+      fill(_stamps.begin(), _stamps.end(), 0);
+      _stamp = 1;
+    }
+
+    _words = 0;
+  }
+
+  /**
+   * Counts codes emitted by lzw, the growth of its dictionary. The dictionary is kept between samples
+   * of the same block and stops growing at the size of the real one
+   * @param sample sample
+   * @param warmup count of the first bytes which are parsed but not counted
+   * @return count of codes
+   */
+  size_t countCodes(span<const uint8_t> sample, size_t warmup) {
+    size_t mask = _keys.size() - 1;
+    size_t codes = 0;
+    uint32_t curr = sample[0];
+
+    for (size_t i = 1; i < sample.size(); i++) {
+      uint32_t key = (curr << BYTE_SIZE) | sample[i];
+      size_t cell = (key * 0x9E3779B97F4A7C15ULL) >> 40 & mask;
+
+      while (_stamps[cell] == _stamp && _keys[cell] != key)
+        cell = (cell + 1) & mask;
+
+      if (_stamps[cell] == _stamp) {
+        // codes of the simulation are the cells, they are unique as well
+        curr = MAX_CHAR + 1 + cell;
+        continue;
+      }
+
+      if (_words < LZW_DICTIONARY_SIZE) {
+        _stamps[cell] = _stamp;
+        _keys[cell] = key;
+        _words++;
+      }
+
+      if (i >= warmup)
+        codes++;
+      curr = sample[i];
+    }
+
+    return codes + 1;
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_AUTOARCHIVER_HPP_
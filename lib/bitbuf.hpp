@@ -5,11 +5,13 @@
 #ifndef HW_ARCHIVER_LIB_BITBUF_HPP_
 #define HW_ARCHIVER_LIB_BITBUF_HPP_
 
-#include <bitset>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include "span.hpp"
+#include "utils.h"
 
 using namespace std;
 
@@ -19,165 +21,208 @@ using namespace std;
 static const int BYTE_SIZE = 8;
 
 /**
- * Converts and returns value from binary string
- * @tparam T value type
- * @param str binary string
- * @return value
+ * Class for bit input manipulation, bits are read from the least significant one of every byte
  */
-template<typename T>
-T fromBinaryString(const string &str) {
-  const int BITS_COUNT = sizeof(T) * BYTE_SIZE;
-  bitset<BITS_COUNT> bits(str);
-  return bits.to_ulong();
-}
-
-/**
- * Converts and returns binary string from value
- * @tparam T value type
- * @param value value
- * @param cl binary string's length
- * @return binary string from value
- */
-template<typename T>
-string toBinaryString(const T &value, const int &cl) {
-  const int BITS_COUNT = sizeof(value) * BYTE_SIZE;
-  bitset<BITS_COUNT> bits(value);
-  return bits.to_string().substr(BITS_COUNT - cl);
-}
-
-/**
- * Abstract calss for bitbif
- */
-class bitbuf {
- protected:
-  vector<bitset<BYTE_SIZE>> bits;
-  int block{0};
-  int cell{0};
-  string code;
-};
-
-/**
- * Class for bit input manipulation
- */
-struct ibitbuf : bitbuf {
+struct ibitbuf {
  public:
+  /**
+   * Default constructor
+   * @param contents contents
+   */
+  explicit ibitbuf(span<const uint8_t> contents) {
+    loadData(contents);
+  }
+
+  /**
+   * Loads contents
+   * @param contents contents
+   */
+  void loadData(span<const uint8_t> contents) {
+    pos = contents.begin();
+    end = contents.end();
+    total = contents.size() * BYTE_SIZE;
+    consumed = 0;
+    acc = 0;
+    count = 0;
+  }
 
   /**
    * Computes and gets the value from the first n bits
    * @tparam T value type
    * @param result value
    * @param size bits count
-   * @return the value from the first n bits
+   * @return true if there were enough bits and false otherwise
    */
   template<typename T>
   bool getData(T &result, int size) {
-    T mask = 1;
-    result = 0;
-
-    int bit;
-
-    for (size_t i = 0; i < size; i++) {
-      bit = readBit();
-
-      if (bit == -1)
-        return false;
-
-      if (bit)
-        result |= mask;
-      mask <<= 1;
+    if (remaining() < (uint64_t) size) {
+      result = 0;
+      return false;
     }
+
+    result = (T) readData(size);
     return true;
   }
 
   /**
- * Computes and gets the value from the first n bits in reverse order
- * @tparam T value type
- * @param result value
- * @param size bits count
- * @return the value from the first n bits in reverse order
- */
+   * Computes and gets the value from the first n bits in reverse order
+   * @tparam T value type
+   * @param result value
+   * @param size bits count
+   * @return true if there were enough bits and false otherwise
+   */
   template<typename T>
   bool getDataReverse(T &result, int size) {
-    T mask = 1 << (size - 1);
-    result = 0;
-
-    int bit;
+    if (remaining() < (uint64_t) size) {
+      result = 0;
+      return false;
+    }
 
-    for (size_t i = 0; i < size; i++) {
-      bit = readBit();
+    result = (T) reverseBits(readData(size), size);
+    return true;
+  }
 
-      if (bit == -1)
-        return false;
+  /**
+   * Reads current bit, if there is no bit available, returns -1
+   * @return current bit
+   */
+  int readBit() {
+    if (count == 0) {
+      refill();
 
-      if (bit)
-        result |= mask;
-      mask >>= 1;
+      if (count == 0)
+        return -1;
     }
-    return true;
+
+    int value = acc & 1;
+    acc >>= 1;
+    count--;
+    consumed++;
+
+    return value;
   }
 
   /**
-   * Default constructor
-   * @param contents
+   * Reads n bits without checking if they are available (missing bits are read as zeros)
+   * @param size bits count, at most 64
+   * @return value of the bits
    */
-  explicit ibitbuf(const vector<uint8_t> &contents) {
-    loadData(contents);
+  uint64_t readData(int size) {
+    if (size > 32) {
+      uint64_t low = readData(32);
+      return low | (readData(size - 32) << 32);
+    }
+
+    if (count < size)
+      refill();
+
+    uint64_t value = acc & lowMask(size);
+    acc >>= size;
+    count = count > size ? count - size : 0;
+    consumed += size;
+
+    return value;
   }
 
   /**
-   * Constructor
-   * @param stream input stream
+   * Returns the next n bits without reading them (missing bits are returned as zeros)
+   * @param size bits count, at most 56
+   * @return value of the bits
    */
-  explicit ibitbuf(istream &stream) {
-    auto begin = istreambuf_iterator<char>(stream);
-    auto end = istreambuf_iterator<char>();
+  uint64_t peekData(int size) {
+    if (count < size)
+      refill();
 
-    vector<uint8_t> contents((istreambuf_iterator<char>(stream)), istreambuf_iterator<char>());
+    return acc & lowMask(size);
+  }
 
-    loadData(contents);
+  /**
+   * Skips n bits, they have to be peeked before
+   * @param size bits count, at most the peeked one
+   */
+  void skip(int size) {
+    acc >>= size;
+    count = count > size ? count - size : 0;
+    consumed += size;
   }
 
   /**
-   * Loads contents
-   * @param contents contents
+   * Returns the next n bits without reading them and without loading more bits, at least n bits
+   * have to be loaded by refill() before
+   * @param size bits count, at most 56
+   * @return value of the bits
    */
-  void loadData(const vector<uint8_t> &contents) {
-    for (const uint8_t &val: contents)
-      bits.emplace_back(val);
+  uint64_t peekLoaded(int size) const {
+    return acc & lowMask(size);
   }
 
   /**
-   * Reads current bit, if there is no bit available, returns -1
-   * @return current bit
+   * Checks if there are at least 8 more bytes to load, then refill() loads at least 56 bits
+   * @return true if there are at least 8 more bytes to load and false otherwise
    */
-  int readBit() {
-    if (block == bits.size())
-      return -1;
+  bool hasMargin() const {
+    return end - pos >= 8;
+  }
 
-    int value = bits[block][cell];
+  /**
+   * Loads as many whole bytes as fit to the accumulator
+   */
+  void refill() {
+    if (end - pos >= 8) {
+      uint64_t word;
+      memcpy(&word, pos, sizeof(word));
+      word = toLittleEndian(word);
+
+      int bytes = (63 - count) >> 3;
+      acc |= (word & lowMask(bytes * BYTE_SIZE)) << count;
+      pos += bytes;
+      count += bytes * BYTE_SIZE;
+      return;
+    }
 
-    if (cell == 7) {
-      cell = 0;
-      block++;
-    } else {
-      cell++;
+    while (count <= 56 && pos != end) {
+      acc |= (uint64_t) *pos++ << count;
+      count += BYTE_SIZE;
     }
+  }
 
-    return value;
+  /**
+   * Counts and returns the count of unread bits
+   * @return count of unread bits
+   */
+  uint64_t remaining() const {
+    return total > consumed ? total - consumed : 0;
   }
 
+  /**
+   * Checks if more bits were read than available
+   * @return true if more bits were read than available and false otherwise
+   */
+  bool overrun() const {
+    return consumed > total;
+  }
+
+ private:
+  const uint8_t *pos{nullptr};
+  const uint8_t *end{nullptr};
+  uint64_t total{0};
+  uint64_t consumed{0};
+  uint64_t acc{0};
+  int count{0};
 };
 
 /**
- * Class for bit output manipulation
+ * Class for bit output manipulation, bits are written from the least significant one of every byte
  */
-class obitbuf : bitbuf {
+class obitbuf {
  public:
   /**
    * Default constructor
+   * @param out buffer to write to
    */
-  obitbuf() {
-    block = -1;
+  explicit obitbuf(span<uint8_t> out) {
+    begin = pos = out.begin();
+    end = out.end();
   }
 
   /**
@@ -185,67 +230,376 @@ class obitbuf : bitbuf {
    * @param bit bit
    */
   void writeBit(const bool &bit) {
-    if (cell == 0) {
-      block++;
-      bits.emplace_back();
+    writeData(bit, 1);
+  }
+
+  /**
+   * Writes the first n bits of value to contents
+   * @param value value
+   * @param size count of bits, at most 64
+   */
+  void writeData(uint64_t value, int size) {
+    if (size > 32) {
+      writeData(value & lowMask(32), 32);
+      writeData(value >> 32, size - 32);
+      return;
     }
 
-    bits[block][cell] = bit;
-    cell = (cell == 7) ? 0 : cell + 1;
+    acc |= (value & lowMask(size)) << count;
+    count += size;
+
+    if (count >= 32) {
+      storeBytes(4);
+      acc >>= 32;
+      count -= 32;
+    }
   }
 
   /**
-   * Write bits of value to contents
-   * @tparam T value type
+   * Writes the first n bits of value to contents in reverse order (the most significant one first)
    * @param value value
-   * @param size count of bits
+   * @param size count of bits, at most 64
    */
-  template<typename T>
-  void writeBits(const T &value, const int &size) {
-    string str = toBinaryString(value, size);
-    addBinaryString(str, true);
+  void writeDataReverse(uint64_t value, int size) {
+    writeData(reverseBits(value, size), size);
   }
 
   /**
-   * Adds binary string to contents
-   * @param str binary string
-   * @param isReversed is binary string in reverse order
+   * Writes pending bits (padding the last byte with zeros)
+   * @return count of written bytes
    */
-  void addBinaryString(string &str, const bool &isReversed = true) {
-    code += str;
-    while (code.length() > BYTE_SIZE) {
-      string s = code.substr(0, BYTE_SIZE);
+  size_t flush() {
+    storeBytes((count + BYTE_SIZE - 1) / BYTE_SIZE);
+    acc = 0;
+    count = 0;
+
+    return pos - begin;
+  }
+
+  /**
+   * Counts and returns the count of written bits
+   * @return count of written bits
+   */
+  uint64_t bitCount() const {
+    return (pos - begin) * BYTE_SIZE + count;
+  }
 
-      if (isReversed)
-        reverse(s.begin(), s.end());
+ private:
+  uint8_t *begin;
+  uint8_t *pos;
+  uint8_t *end;
+  uint64_t acc{0};
+  int count{0};
+
+  /**
+   * Stores the low bytes of the accumulator
+   * @param bytes count of bytes
+   */
+  void storeBytes(int bytes) {
+    if (end - pos < bytes)
+      error("Output buffer is too small.");
+
+    for (int i = 0; i < bytes; i++)
+      pos[i] = (uint8_t) (acc >> (i * BYTE_SIZE));
+    pos += bytes;
+  }
+};
+
+/**
+ * Class for byte output, writes to a fixed buffer, to a growing vector or to a stream. The stream mode
+ * keeps the written bytes in a window which grows up to twice the history, then the bytes older than
+ * the history are flushed to the stream, so copyMatch reaches back the history and the memory does not
+ * depend on the size of the output
+ */
+class obytebuf {
+ public:
+  /**
+   * Initial size of the window of the stream mode
+   */
+  static constexpr size_t STREAM_WINDOW = 64 << 10;
 
-      bits.emplace_back(s);
-      code.erase(0, BYTE_SIZE);
-      block++;
+  /**
+   * Constructor for a fixed buffer, overflowing it throws an exception
+   * @param out buffer to write to
+   */
+  explicit obytebuf(span<uint8_t> out) {
+    begin = pos = out.begin();
+    end = out.end();
+  }
+
+  /**
+   * Constructor for a growing vector, its contents are replaced
+   * @param out vector to write to
+   */
+  explicit obytebuf(vector<uint8_t> &out) : vec(&out) {
+    out.resize(max<size_t>(out.capacity(), 64));
+    begin = pos = out.data();
+    end = begin + out.size();
+  }
+
+  /**
+   * Constructor for a stream, the kept bytes are written by flush
+   * @param out stream to write to
+   */
+  explicit obytebuf(ostream &out) : stream(&out), window(STREAM_WINDOW) {
+    begin = pos = window.data();
+    end = begin + window.size();
+  }
+
+  ~obytebuf() {
+    if (vec)
+      vec->resize(size());
+  }
+
+  obytebuf(const obytebuf &) = delete;
+  obytebuf &operator=(const obytebuf &) = delete;
+
+  /**
+   * Writes byte
+   * @param value byte
+   */
+  void put(uint8_t value) {
+    if (pos == end)
+      reserve(1);
+    *pos++ = value;
+  }
+
+  /**
+   * Writes bytes
+   * @param data bytes
+   * @param size count of bytes
+   */
+  void write(const uint8_t *data, size_t size) {
+    if ((size_t) (end - pos) < size)
+      reserve(size);
+    memcpy(pos, data, size);
+    pos += size;
+  }
+
+  /**
+   * Copies earlier written bytes to the end, regions may overlap
+   * @param distance distance back from the end
+   * @param length count of bytes
+   */
+  void copyMatch(size_t distance, size_t length) {
+    if ((size_t) (end - pos) < length)
+      reserve(length);
+
+    const uint8_t *from = pos - distance;
+    for (size_t i = 0; i < length; i++)
+      pos[i] = from[i];
+    pos += length;
+  }
+
+  /**
+   * Appends n bytes to be filled by the caller
+   * @param size count of bytes
+   * @return pointer to the appended bytes
+   */
+  uint8_t *extend(size_t size) {
+    if ((size_t) (end - pos) < size)
+      reserve(size);
+
+    uint8_t *result = pos;
+    pos += size;
+
+    return result;
+  }
+
+  /**
+   * Removes the last written byte
+   */
+  void pop() {
+    if (pos != begin)
+      pos--;
+  }
+
+  /**
+   * Returns count of written bytes
+   * @return count of written bytes
+   */
+  size_t size() const {
+    return flushed + (pos - begin);
+  }
+
+  /**
+   * Returns pointer to the written bytes, in the stream mode to the bytes which are not flushed yet
+   * @return pointer to the written bytes
+   */
+  const uint8_t *data() const {
+    return begin;
+  }
+
+  /**
+   * Returns the last written bytes, they have to be kept by the stream mode
+   * @param size count of bytes
+   * @return pointer to the bytes
+   */
+  const uint8_t *tail(size_t size) const {
+    if ((size_t) (pos - begin) < size)
+      error("Invalid history size.");
+
+    return pos - size;
+  }
+
+  /**
+   * Sets count of the last bytes reached by copyMatch, used only by the stream mode
+   * @param size count of bytes
+   */
+  void keep(size_t size) {
+    history = size;
+  }
+
+  /**
+   * Writes the bytes which are not flushed yet to the stream
+   */
+  void flush() {
+    if (!stream)
+      return;
+
+    stream->write((const char *) begin, pos - begin);
+    flushed += pos - begin;
+    pos = begin;
+  }
+
+ private:
+  vector<uint8_t> *vec{nullptr};
+  uint8_t *begin;
+  uint8_t *pos;
+  uint8_t *end;
+
+  /**
+   * Stream, its window, count of the last bytes kept in the window and count of the flushed bytes
+   */
+  ostream *stream{nullptr};
+  vector<uint8_t> window;
+  size_t history{0};
+  size_t flushed{0};
+
+  /**
+   * Makes room for n more bytes
+   * @param size count of bytes
+   */
+  void reserve(size_t size) {
+    if (stream) {
+      slide(size);
+      return;
     }
-    cell = code.length();
+
+    if (!vec)
+      error("Output buffer is too small.");
+
+    size_t used = this->size();
+    vec->resize(max(vec->size() * 2, used + size));
+    begin = vec->data();
+    pos = begin + used;
+    end = begin + vec->size();
   }
 
   /**
-   * Writes all contents to stream
-   * @param outFile out stream
-   * @param isReversed is binary string in reverse order
+   * Makes room for n more bytes in the stream mode: flushes the bytes older than the history
+   * if the window is full, otherwise grows it
+   * @param size count of bytes
    */
-  void writeToStream(ostream &outFile, const bool &isReversed = true) {
-    if (isReversed)
-      reverse(code.begin(), code.end());
+  void slide(size_t size) {
+    size_t used = pos - begin;
 
-    if (!code.empty()) {
-      bits.emplace_back(code);
-      block++;
+    if (used > history && window.size() >= 2 * history) {
+      size_t drop = used - history;
+
+      stream->write((const char *) begin, drop);
+      memmove(begin, begin + drop, history);
+      flushed += drop;
+      used = history;
     }
 
-    code = "";
-    cell = 0;
+    if (window.size() - used < size)
+      window.resize(max(window.size() * 2, used + size));
 
-    for (const bitset<BYTE_SIZE> &val: bits)
-      outFile.put((char) val.to_ulong());
+    begin = window.data();
+    pos = begin + used;
+    end = begin + window.size();
   }
 };
 
+/**
+ * Writes number by 7 bits per byte, the high bit shows that more bytes follow
+ * @param bout bitbuf
+ * @param value number
+ */
+static inline void writeVarint(obitbuf &bout, uint64_t value) {
+  while (value >= 0x80) {
+    bout.writeData((value & 0x7F) | 0x80, BYTE_SIZE);
+    value >>= 7;
+  }
+
+  bout.writeData(value, BYTE_SIZE);
+}
+
+/**
+ * Reads number written by writeVarint
+ * @param in buffer
+ * @param pos position of the number, moved past it
+ * @return number
+ */
+static inline uint64_t readVarint(span<const uint8_t> in, size_t &pos) {
+  uint64_t value = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (pos >= in.size())
+      error("Unexpected end of stream.");
+
+    uint8_t byte = in[pos++];
+    value |= (uint64_t) (byte & 0x7F) << shift;
+
+    if (!(byte & 0x80))
+      return value;
+  }
+
+  error("Invalid varint.");
+}
+
+/**
+ * Writes 4 bytes number in little endian order
+ * @param out output
+ * @param value number
+ */
+static inline void writeUint32(uint8_t *out, uint32_t value) {
+  uint8_t bytes[4] = {(uint8_t) value, (uint8_t) (value >> 8), (uint8_t) (value >> 16), (uint8_t) (value >> 24)};
+  memcpy(out, bytes, sizeof(bytes));
+}
+
+/**
+ * Reads 4 bytes number in little endian order
+ * @param in input
+ * @return number
+ */
+static inline uint32_t readUint32(const uint8_t *in) {
+  uint32_t value = 0;
+
+  for (int i = 0; i < 4; i++)
+    value |= (uint32_t) in[i] << (i * BYTE_SIZE);
+
+  return value;
+}
+
+/**
+ * Writes 8 bytes number in little endian order
+ * @param out output
+ * @param value number
+ */
+static inline void writeUint64(uint8_t *out, uint64_t value) {
+  writeUint32(out, (uint32_t) value);
+  writeUint32(out + 4, (uint32_t) (value >> 32));
+}
+
+/**
+ * Reads 8 bytes number in little endian order
+ * @param in input
+ * @return number
+ */
+static inline uint64_t readUint64(const uint8_t *in) {
+  return readUint32(in) | ((uint64_t) readUint32(in + 4) << 32);
+}
+
 #endif //HW_ARCHIVER_LIB_BITBUF_HPP_
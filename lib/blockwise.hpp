@@ -0,0 +1,307 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_BLOCKWISE_HPP_
+#define HW_ARCHIVER_LIB_BLOCKWISE_HPP_
+
+#include "archiver.hpp"
+#include "checksum.hpp"
+#include <memory>
+
+/**
+ * Archiver which compresses input block by block and stores blocks which would not get smaller.
+ * Blocks are checked by the entropy of a few samples before compression, so already compressed data
+ * costs almost no time, and a block is also stored if its compressed size is not less than its size.
+ * Every block: method (0 for stored block, otherwise codec's index + 1), size, size of the payload,
+ * checksum (all 4 bytes, little endian), payload. The stream ends with the trailer: END method and
+ * the stream's checksum (8 bytes). The block's checksum is the low half of the xxHash64 of its contents,
+ * the stream's checksum is the xxHash64 of all blocks' xxHash64 values, so both are counted
+ * in one pass while the block is still in the cache, and missing or reordered blocks are detected
+ */
+class blockwise : public archiver {
+ public:
+  /**
+   * Method of stored blocks
+   */
+  static constexpr uint8_t STORED = 0;
+
+  /**
+   * Method of the trailer
+   */
+  static constexpr uint8_t END = 0xFF;
+
+  /**
+   * Size of the block's header
+   */
+  static constexpr unsigned int HEADER_SIZE = 13;
+
+  /**
+   * Size of the trailer
+   */
+  static constexpr unsigned int TRAILER_SIZE = 9;
+
+  /**
+   * Default constructor
+   * @param inner archiver for blocks, owned by blockwise
+   * @param blockSize size of blocks
+   * @param threshold sampled entropy (from 0 to 1) from which blocks are stored without trying to compress
+   */
+  explicit blockwise(archiver *inner, size_t blockSize = 1 << 20, double threshold = 0.98)
+      : blockwise(blockSize, threshold) {
+    _codecs.emplace_back(inner);
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    size_t blocks = (size + _blockSize - 1) / _blockSize;
+    size_t last = min(size, _blockSize);
+
+    // stored blocks are never larger than compressed ones, the current block may need the codec's bound
+    size_t slack = 0;
+    for (const auto &codec: _codecs)
+      slack = max(slack, codec->compressBound(last) - min(last, codec->compressBound(last)));
+
+    return blocks * HEADER_SIZE + size + slack + TRAILER_SIZE;
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    xxhash64 streamHash;
+    size_t size = 0;
+    uint64_t hash;
+
+    for (size_t pos = 0; pos < in.size(); pos += _blockSize) {
+      size += compressBlock(in.subspan(pos, min(_blockSize, in.size() - pos)), out.subspan(size), hash);
+      addBlockHash(streamHash, hash);
+    }
+
+    if (out.size() - size < TRAILER_SIZE)
+      error("Output buffer is too small.");
+
+    writeTrailer(out.data() + size, streamHash);
+
+    return size + TRAILER_SIZE;
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    xxhash64 streamHash;
+
+    for (size_t pos = 0;;) {
+      if (in.size() - pos >= TRAILER_SIZE && in[pos] == END) {
+        checkTrailer(in.data() + pos, streamHash);
+
+        if (in.size() - pos != TRAILER_SIZE)
+          error("Unexpected data after the end of stream.");
+
+        return;
+      }
+
+      if (in.size() - pos < HEADER_SIZE)
+        error("Unexpected end of stream.");
+
+      size_t blockSize = HEADER_SIZE + getPayloadSize(in.data() + pos);
+
+      if (blockSize > in.size() - pos)
+        error("Unexpected end of stream.");
+
+      addBlockHash(streamHash, decompressBlock(in.subspan(pos, blockSize), out));
+      pos += blockSize;
+    }
+  }
+
+  /**
+   * Returns size of blocks
+   * @return size of blocks
+   */
+  size_t getBlockSize() const {
+    return _blockSize;
+  }
+
+  /**
+   * Compress block and writes it with its header, blocks of one stream may be compressed
+   * by different instances in any order
+   * @param block block, at most getBlockSize() bytes
+   * @param out output buffer, at least compressBound(getBlockSize()) bytes
+   * @param hash xxHash64 of the block for the stream's checksum
+   * @return count of written bytes
+   */
+  size_t compressBlock(span<const uint8_t> block, span<uint8_t> out, uint64_t &hash) {
+    int codec = chooseCodec(block);
+    uint8_t method = STORED;
+    size_t payloadSize = block.size();
+
+    if (codec >= 0) {
+      if (out.size() < HEADER_SIZE)
+        error("Output buffer is too small.");
+
+      size_t size = _codecs[codec]->compress(block, out.subspan(HEADER_SIZE));
+
+      if (size < block.size()) {
+        method = codec + 1;
+        payloadSize = size;
+      }
+    }
+
+    if (out.size() < HEADER_SIZE + payloadSize)
+      error("Output buffer is too small.");
+
+    if (method == STORED)
+      memcpy(out.data() + HEADER_SIZE, block.data(), block.size());
+
+    hash = xxhash64::hash(block);
+
+    out[0] = method;
+    writeUint32(out.data() + 1, block.size());
+    writeUint32(out.data() + 5, payloadSize);
+    writeUint32(out.data() + 9, (uint32_t) hash);
+
+    return HEADER_SIZE + payloadSize;
+  }
+
+  /**
+   * Decompress block with its header and checks its checksum
+   * @param block the block's header and payload
+   * @param out output for decompressed data
+   * @return xxHash64 of the decompressed block for the stream's checksum
+   */
+  uint64_t decompressBlock(span<const uint8_t> block, obytebuf &out) {
+    if (block.size() < HEADER_SIZE || block.size() - HEADER_SIZE != getPayloadSize(block.data()))
+      error("Unexpected end of stream.");
+
+    uint8_t method = block[0];
+    uint64_t size = readUint32(block.data() + 1);
+    uint32_t checksum = readUint32(block.data() + 9);
+
+    span<const uint8_t> payload = block.subspan(HEADER_SIZE);
+    size_t begin = out.size();
+
+    if (method == STORED) {
+      out.write(payload.data(), payload.size());
+    } else if (method <= _codecs.size()) {
+      _codecs[method - 1]->decompress(payload, out);
+    } else {
+      error("Invalid block method.");
+    }
+
+    if (out.size() - begin != size)
+      error("Invalid block size.");
+
+    uint64_t hash = xxhash64::hash(span<const uint8_t>(out.data() + begin, size));
+
+    if ((uint32_t) hash != checksum)
+      error("Block checksum mismatch.");
+
+    return hash;
+  }
+
+  /**
+   * Returns size of the block's payload
+   * @param header the block's header
+   * @return size of the payload
+   */
+  static size_t getPayloadSize(const uint8_t *header) {
+    return readUint32(header + 5);
+  }
+
+  /**
+   * Adds the block's checksum to the stream's checksum, blocks have to be added in their order
+   * @param streamHash stream's checksum
+   * @param hash xxHash64 of the block
+   */
+  static void addBlockHash(xxhash64 &streamHash, uint64_t hash) {
+    uint8_t bytes[8];
+
+    writeUint64(bytes, hash);
+    streamHash.update(span<const uint8_t>(bytes, sizeof(bytes)));
+  }
+
+  /**
+   * Writes the trailer
+   * @param out output, at least TRAILER_SIZE bytes
+   * @param streamHash stream's checksum
+   */
+  static void writeTrailer(uint8_t *out, const xxhash64 &streamHash) {
+    out[0] = END;
+    writeUint64(out + 1, streamHash.digest());
+  }
+
+  /**
+   * Checks the stream's checksum by the trailer
+   * @param in the trailer, TRAILER_SIZE bytes
+   * @param streamHash stream's checksum
+   */
+  static void checkTrailer(const uint8_t *in, const xxhash64 &streamHash) {
+    if (in[0] != END || readUint64(in + 1) != streamHash.digest())
+      error("Stream checksum mismatch.");
+  }
+
+ protected:
+  /**
+   * Archivers for blocks
+   */
+  vector<unique_ptr<archiver>> _codecs;
+
+  /**
+   * Size of blocks
+   */
+  size_t _blockSize;
+
+  /**
+   * Sampled entropy from which blocks are stored
+   */
+  double _threshold;
+
+  /**
+   * Constructor without codecs
+   * @param blockSize size of blocks
+   * @param threshold sampled entropy from which blocks are stored without trying to compress
+   */
+  blockwise(size_t blockSize, double threshold) {
+    if (blockSize == 0 || blockSize > UINT32_MAX)
+      error("Invalid block size.");
+
+    _blockSize = blockSize;
+    _threshold = threshold;
+  }
+
+  /**
+   * Chooses codec for the block
+   * @param block block
+   * @return index of the codec or -1 if the block should be stored
+   */
+  virtual int chooseCodec(span<const uint8_t> block) {
+    return sampleEntropy(block) >= _threshold ? -1 : 0;
+  }
+
+  /**
+   * Estimates entropy (from 0 to 1) of the block by its evenly spaced samples
+   * @param block block
+   * @param sampleSize size of every sample
+   * @param samples count of samples
+   * @return entropy of the samples
+   */
+  static double sampleEntropy(span<const uint8_t> block, size_t sampleSize = 4096, size_t samples = 4) {
+    int freqs[MAX_CHAR] = {};
+    size_t total = 0;
+
+    if (block.size() <= sampleSize * samples) {
+      for (const uint8_t &ch: block)
+        freqs[ch]++;
+      total = block.size();
+    } else {
+      for (size_t k = 0; k < samples; k++) {
+        size_t offset = k * (block.size() - sampleSize) / (samples - 1);
+
+        for (size_t i = offset; i < offset + sampleSize; i++)
+          freqs[block[i]]++;
+      }
+      total = sampleSize * samples;
+    }
+
+    return total ? getEntropy(freqs, total) : 0;
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_BLOCKWISE_HPP_
@@ -0,0 +1,483 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_BWT_HPP_
+#define HW_ARCHIVER_LIB_BWT_HPP_
+
+#include "huffman.hpp"
+
+/**
+ * Class for block-sorting compression: Burrows-Wheeler transform by the suffix array (SA-IS, linear time),
+ * move-to-front, run-length coding of zero runs and the interleaved huffman. The whole input is one block,
+ * so it is meant to be used by blockwise, parallel blocks are compressed by pipeline.
+ * Stream: size (4 bytes), index of the end of the text in the transform (4 bytes), huffman stream of symbols.
+ * Symbols: zero runs are written by RUN_A and RUN_B as digits of bijective base 2 numbers,
+ * rank r < ESCAPE - 1 is r + 1, greater ranks are ESCAPE and r - ESCAPE + 1
+ */
+class bwt : public archiver {
+ public:
+  /**
+   * Maximal size of the input, the decoder packs indices of the transform with bytes to 32 bits
+   */
+  static constexpr size_t MAX_SIZE = ((size_t) 1 << 24) - 2;
+
+  /**
+   * Size of the header
+   */
+  static constexpr unsigned int HEADER_SIZE = 8;
+
+  /**
+   * Symbols of zero runs
+   */
+  static constexpr uint8_t RUN_A = 0, RUN_B = 1;
+
+  /**
+   * Symbol of ranks which do not fit to one byte
+   */
+  static constexpr uint8_t ESCAPE = 255;
+
+  /**
+   * Reusable working memory for compression and decompression
+   */
+  struct context {
+    /**
+     * Text shifted by one with the zero sentinel, and the suffix array
+     */
+    vector<int32_t> text, sa;
+
+    /**
+     * Transform of the text without the sentinel
+     */
+    vector<uint8_t> transform;
+
+    /**
+     * Symbols coded by huffman
+     */
+    vector<uint8_t> symbols;
+
+    /**
+     * Rows of the inverse transform: (index of the previous row << 8) | byte
+     */
+    vector<uint32_t> rows;
+  };
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    // every rank takes at most two symbols
+    return HEADER_SIZE + _huffman.compressBound(2 * size);
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    return compress(_ctx, in, out);
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    decompress(_ctx, in, out);
+  }
+
+  /**
+   * Compress buffer using given context
+   * @param ctx context
+   * @param in buffer to compress, at most MAX_SIZE bytes
+   * @param out buffer for compressed data
+   * @return count of compressed bytes
+   */
+  size_t compress(context &ctx, span<const uint8_t> in, span<uint8_t> out) {
+    if (in.size() > MAX_SIZE)
+      error("Input is too large for bwt.");
+
+    if (out.size() < HEADER_SIZE)
+      error("Output buffer is too small.");
+
+    uint32_t primary = transform(ctx, in);
+    encodeRanks(ctx);
+
+    writeUint32(out.data(), in.size());
+    writeUint32(out.data() + 4, primary);
+
+    return HEADER_SIZE + _huffman.compress(ctx.symbols, out.subspan(HEADER_SIZE));
+  }
+
+  /**
+   * Decompress buffer using given context
+   * @param ctx context
+   * @param in buffer to decompress
+   * @param out output for decompressed data
+   */
+  void decompress(context &ctx, span<const uint8_t> in, obytebuf &out) {
+    if (in.size() < HEADER_SIZE)
+      error("Unexpected end of stream.");
+
+    size_t n = readUint32(in.data());
+    size_t primary = readUint32(in.data() + 4);
+
+    if (n > MAX_SIZE || (n > 0 && (primary == 0 || primary > n)) || (n == 0 && primary != 0))
+      error("Invalid bwt header.");
+
+    _huffman.decompress(in.subspan(HEADER_SIZE), ctx.symbols);
+    decodeRanks(ctx, n);
+    inverseTransform(ctx, primary, out.extend(n));
+  }
+
+ private:
+  /**
+   * Default context
+   */
+  context _ctx;
+
+  /**
+   * Entropy coder of symbols
+   */
+  huffman _huffman{true};
+
+  /**
+   * Makes the transform of the input to the context
+   * @param ctx context
+   * @param in input
+   * @return index of the sentinel's row which is skipped in the transform
+   */
+  static uint32_t transform(context &ctx, span<const uint8_t> in) {
+    const size_t n = in.size();
+
+    ctx.text.resize(n + 1);
+    ctx.sa.resize(n + 1);
+
+    for (size_t i = 0; i < n; i++)
+      ctx.text[i] = in[i] + 1;
+    ctx.text[n] = 0;
+
+    sais(ctx.text.data(), ctx.sa.data(), n + 1, MAX_CHAR);
+
+    // the first row is the sentinel's suffix, its previous byte is the last one
+    ctx.transform.resize(n);
+    uint32_t primary = 0;
+
+    for (size_t i = 0, j = 0; i <= n; i++) {
+      if (ctx.sa[i] == 0)
+        primary = i;
+      else
+        ctx.transform[j++] = in[ctx.sa[i] - 1];
+    }
+
+    return primary;
+  }
+
+  /**
+   * Restores the text by the transform in the context's symbols
+   * @param ctx context
+   * @param primary index of the sentinel's row
+   * @param out output, as many bytes as the transform has
+   */
+  static void inverseTransform(context &ctx, size_t primary, uint8_t *out) {
+    const size_t n = ctx.transform.size();
+    size_t starts[MAX_CHAR] = {};
+
+    for (const uint8_t &ch: ctx.transform)
+      starts[ch]++;
+
+    // the sentinel's row is the first one
+    for (size_t ch = 0, sum = 1; ch < MAX_CHAR; ch++) {
+      size_t count = starts[ch];
+      starts[ch] = sum;
+      sum += count;
+    }
+
+    // every row has the byte before its suffix and the row of the suffix starting with that byte
+    ctx.rows.resize(n + 1);
+    ctx.rows[primary] = 0;
+
+    for (size_t i = 0, j = 0; i <= n; i++) {
+      if (i == primary)
+        continue;
+
+      uint8_t ch = ctx.transform[j++];
+      ctx.rows[i] = (uint32_t) (starts[ch]++ << BYTE_SIZE) | ch;
+    }
+
+    uint32_t row = 0;
+    for (size_t k = n; k > 0; k--) {
+      uint32_t entry = ctx.rows[row];
+      out[k - 1] = (uint8_t) entry;
+      row = entry >> BYTE_SIZE;
+    }
+  }
+
+  /**
+   * Codes the context's transform by move-to-front and zero runs to the context's symbols
+   * @param ctx context
+   */
+  static void encodeRanks(context &ctx) {
+    uint8_t order[MAX_CHAR];
+    for (int i = 0; i < MAX_CHAR; i++)
+      order[i] = i;
+
+    ctx.symbols.resize(2 * ctx.transform.size());
+    uint8_t *dst = ctx.symbols.data();
+    size_t run = 0;
+
+    for (const uint8_t &ch: ctx.transform) {
+      if (order[0] == ch) {
+        run++;
+        continue;
+      }
+
+      dst = writeRun(dst, run);
+      run = 0;
+
+      int rank = 1;
+      uint8_t prev = order[0];
+
+      while (order[rank] != ch) {
+        swap(prev, order[rank]);
+        rank++;
+      }
+
+      order[rank] = prev;
+      order[0] = ch;
+
+      if (rank < ESCAPE - 1) {
+        *dst++ = rank + 1;
+      } else {
+        *dst++ = ESCAPE;
+        *dst++ = rank - (ESCAPE - 1);
+      }
+    }
+
+    dst = writeRun(dst, run);
+    ctx.symbols.resize(dst - ctx.symbols.data());
+  }
+
+  /**
+   * Writes the zero run by RUN_A (digit 1) and RUN_B (digit 2), the least significant digit first
+   * @param dst output
+   * @param run length of the run
+   * @return the end of the output
+   */
+  static uint8_t *writeRun(uint8_t *dst, size_t run) {
+    while (run > 0) {
+      if (run & 1) {
+        *dst++ = RUN_A;
+        run = (run - 1) >> 1;
+      } else {
+        *dst++ = RUN_B;
+        run = (run - 2) >> 1;
+      }
+    }
+
+    return dst;
+  }
+
+  /**
+   * Decodes the context's symbols to the context's transform
+   * @param ctx context
+   * @param n size of the transform
+   */
+  static void decodeRanks(context &ctx, size_t n) {
+    uint8_t order[MAX_CHAR];
+    for (int i = 0; i < MAX_CHAR; i++)
+      order[i] = i;
+
+    ctx.transform.resize(n);
+    uint8_t *dst = ctx.transform.data();
+    uint8_t *end = dst + n;
+
+    const uint8_t *src = ctx.symbols.data();
+    const uint8_t *last = src + ctx.symbols.size();
+    size_t run = 0, weight = 1;
+
+    while (src < last) {
+      uint8_t symbol = *src++;
+
+      if (symbol <= RUN_B) {
+        run += weight << symbol;
+        weight <<= 1;
+
+        if (run > (size_t) (end - dst))
+          error("Invalid bwt stream.");
+        continue;
+      }
+
+      if (run > 0)
+        memset(dst, order[0], run);
+      dst += run;
+      run = 0;
+      weight = 1;
+
+      int rank = symbol - 1;
+
+      if (symbol == ESCAPE) {
+        if (src == last || *src > MAX_CHAR - ESCAPE)
+          error("Invalid bwt stream.");
+
+        rank = *src++ + (ESCAPE - 1);
+      }
+
+      if (dst == end)
+        error("Invalid bwt stream.");
+
+      uint8_t ch = order[rank];
+      memmove(order + 1, order, rank);
+      order[0] = ch;
+
+      *dst++ = ch;
+    }
+
+    if (run != (size_t) (end - dst))
+      error("Invalid bwt stream.");
+
+    if (run > 0)
+      memset(dst, order[0], run);
+  }
+
+  /**
+   * Counts starts or ends of buckets of characters
+   * @param s text
+   * @param n size of the text
+   * @param k maximal character
+   * @param buckets starts or ends of buckets
+   * @param ends if true, ends are counted
+   */
+  static void getBuckets(const int32_t *s, size_t n, int32_t k, vector<int32_t> &buckets, bool ends) {
+    buckets.assign(k + 1, 0);
+
+    for (size_t i = 0; i < n; i++)
+      buckets[s[i]]++;
+
+    int32_t sum = 0;
+    for (int32_t ch = 0; ch <= k; ch++) {
+      sum += buckets[ch];
+      buckets[ch] = ends ? sum : sum - buckets[ch];
+    }
+  }
+
+  /**
+   * Induces positions of L-type and then S-type suffixes by the sorted ones
+   * @param s text
+   * @param sa suffix array
+   * @param types types of suffixes, true for S-type
+   * @param n size of the text
+   * @param k maximal character
+   * @param buckets buffer for buckets
+   */
+  static void induce(const int32_t *s, int32_t *sa, const vector<uint8_t> &types, size_t n, int32_t k,
+                     vector<int32_t> &buckets) {
+    getBuckets(s, n, k, buckets, false);
+
+    for (size_t i = 0; i < n; i++) {
+      int32_t j = sa[i] - 1;
+      if (j >= 0 && !types[j])
+        sa[buckets[s[j]]++] = j;
+    }
+
+    getBuckets(s, n, k, buckets, true);
+
+    for (size_t i = n; i-- > 0;) {
+      int32_t j = sa[i] - 1;
+      if (j >= 0 && types[j])
+        sa[--buckets[s[j]]] = j;
+    }
+  }
+
+  /**
+   * Builds the suffix array by SA-IS
+   * @param s text ending with the unique zero sentinel
+   * @param sa suffix array
+   * @param n size of the text
+   * @param k maximal character
+   */
+  static void sais(const int32_t *s, int32_t *sa, size_t n, int32_t k) {
+    if (n == 1) {
+      sa[0] = 0;
+      return;
+    }
+
+    vector<uint8_t> types(n);
+    vector<int32_t> buckets;
+
+    types[n - 1] = true;
+    for (size_t i = n - 1; i-- > 0;)
+      types[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && types[i + 1]);
+
+    auto isLms = [&](size_t i) { return i > 0 && types[i] && !types[i - 1]; };
+
+    // sorts LMS substrings
+    getBuckets(s, n, k, buckets, true);
+    fill(sa, sa + n, -1);
+
+    for (size_t i = 1; i < n; i++)
+      if (isLms(i))
+        sa[--buckets[s[i]]] = i;
+
+    induce(s, sa, types, n, k, buckets);
+
+    size_t n1 = 0;
+    for (size_t i = 0; i < n; i++)
+      if (isLms(sa[i]))
+        sa[n1++] = sa[i];
+
+    // names LMS substrings, equal substrings get equal names
+    fill(sa + n1, sa + n, -1);
+    int32_t name = 0;
+    int64_t prev = -1;
+
+    for (size_t i = 0; i < n1; i++) {
+      size_t pos = sa[i];
+      bool diff = false;
+
+      for (size_t d = 0; d < n; d++) {
+        if (prev < 0 || s[pos + d] != s[prev + d] || types[pos + d] != types[prev + d]) {
+          diff = true;
+          break;
+        }
+
+        if (d > 0 && (isLms(pos + d) || isLms(prev + d)))
+          break;
+      }
+
+      if (diff) {
+        name++;
+        prev = pos;
+      }
+
+      sa[n1 + pos / 2] = name - 1;
+    }
+
+    for (size_t i = n, j = n; i-- > n1;)
+      if (sa[i] >= 0)
+        sa[--j] = sa[i];
+
+    // sorts LMS suffixes by the reduced text
+    int32_t *s1 = sa + n - n1;
+
+    if ((size_t) name < n1) {
+      sais(s1, sa, n1, name - 1);
+    } else {
+      for (size_t i = 0; i < n1; i++)
+        sa[s1[i]] = i;
+    }
+
+    for (size_t i = 1, j = 0; i < n; i++)
+      if (isLms(i))
+        s1[j++] = i;
+
+    for (size_t i = 0; i < n1; i++)
+      sa[i] = s1[sa[i]];
+
+    // puts sorted LMS suffixes to the ends of their buckets and induces the rest
+    getBuckets(s, n, k, buckets, true);
+    fill(sa + n1, sa + n, -1);
+
+    for (size_t i = n1; i-- > 0;) {
+      int32_t j = sa[i];
+      sa[i] = -1;
+      sa[--buckets[s[j]]] = j;
+    }
+
+    induce(s, sa, types, n, k, buckets);
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_BWT_HPP_
@@ -0,0 +1,327 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_CONTAINER_HPP_
+#define HW_ARCHIVER_LIB_CONTAINER_HPP_
+
+#include "autoarchiver.hpp"
+#include "dedup.hpp"
+#include "levels.hpp"
+#include "lzw.hpp"
+
+/**
+ * Archiver which writes the self-describing header before the stream of its codec, so any stream
+ * is decompressed without knowing how it was compressed. Streams of other codecs or parameters are
+ * decompressed by the archiver created by their header, which is kept for the next streams.
+ * Header: magic "HWAR", version (1 byte), codec (1 byte), count of parameters (1 byte),
+ * parameters (4 bytes each, little endian)
+ */
+class container : public archiver {
+ public:
+  /**
+   * Codecs, their identifiers are stored in streams and never change
+   */
+  enum codecs {
+    HUFFMAN = 1, HUFFMAN4 = 2, CTXHUFFMAN = 3, LZ77 = 4, LZ77LONG = 5, LZW = 6, AUTO = 7, BWT = 8, LEVEL = 9,
+    DEDUP = 10
+  };
+
+  /**
+   * Version of the header
+   */
+  static constexpr uint8_t VERSION = 1;
+
+  /**
+   * Magic bytes of the header
+   */
+  static constexpr char MAGIC[] = "HWAR";
+
+  static constexpr unsigned int MAGIC_SIZE = 4;
+
+  /**
+   * Maximal count of parameters
+   */
+  static constexpr unsigned int MAX_PARAMS = 4;
+
+  /**
+   * Maximal size of the header
+   */
+  static constexpr unsigned int MAX_HEADER_SIZE = MAGIC_SIZE + 3 + 4 * MAX_PARAMS;
+
+  /**
+   * Codec with its name and the default parameters
+   */
+  struct codecinfo {
+    const char *name;
+
+    codecs codec;
+
+    /**
+     * Count of parameters, missing ones take the defaults
+     */
+    unsigned int count;
+
+    uint32_t defaults[MAX_PARAMS];
+  };
+
+  /**
+   * Known codecs: lz77 takes window, lookahead and depth, lz77long the same and the parse strategy,
+   * lzw the word length, bwt the block size, level the level, dedup the binary logarithm of the average chunk's
+   * size and the level compressing the unique chunks
+   */
+  static constexpr codecinfo CODECS[] = {
+      {"huff", HUFFMAN, 0, {}},
+      {"huff4", HUFFMAN4, 0, {}},
+      {"huffctx", CTXHUFFMAN, 1, {ctxhuffman::MAX_GROUPS}},
+      {"lz77", LZ77, 3, {16 * 1024, 4 * 1024, 0}},
+      {"lz77long", LZ77LONG, 4, {64 << 20, 1 << 16, 64, lz77long::GREEDY}},
+      {"lzw", LZW, 1, {16}},
+      {"auto", AUTO, 0, {}},
+      {"bwt", BWT, 1, {1 << 20}},
+      {"level", LEVEL, 1, {levels::DEFAULT_LEVEL}},
+      {"dedup", DEDUP, 2, {13, levels::DEFAULT_LEVEL}},
+  };
+
+  /**
+   * Default constructor
+   * @param codec codec
+   * @param params parameters, missing ones take the defaults
+   * @param threads count of threads used by the codec, more than one only for the codecs which use them
+   * @param budget maximal memory of compression in bytes for levels, 0 for no limit, it is not stored in the header
+   */
+  explicit container(codecs codec = LEVEL, const vector<uint32_t> &params = {}, unsigned int threads = 1,
+                     size_t budget = 0) {
+    const codecinfo &info = getInfo(codec);
+
+    if (params.size() > info.count)
+      error("Too many codec parameters.");
+
+    if (threads > 1 && !isThreaded(codec))
+      error("Codec " + string(info.name) + " does not use threads.");
+
+    _threads = threads;
+    _codec = codec;
+    _params.assign(info.defaults, info.defaults + info.count);
+    copy(params.begin(), params.end(), _params.begin());
+
+    if (_params.size() > MAX_PARAMS)
+      error("Too many codec parameters.");
+
+    _archiver.reset(create(_codec, _params, _threads, budget));
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    return MAX_HEADER_SIZE + _archiver->compressBound(size);
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    return compress(in, 0, out);
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    decompress(in, 0, out);
+  }
+
+  size_t compress(span<const uint8_t> in, size_t primed, span<uint8_t> out) override {
+    uint8_t header[MAX_HEADER_SIZE];
+    size_t size = writeHeader(header);
+
+    if (out.size() < size)
+      error("Output buffer is too small.");
+
+    memcpy(out.data(), header, size);
+
+    return size + _archiver->compress(in, primed, out.subspan(size));
+  }
+
+  void decompress(span<const uint8_t> in, size_t primed, obytebuf &out) override {
+    size_t pos = 0;
+    archiver &arch = readHeader([&](uint8_t *dst, size_t size) {
+      if (in.size() - pos < size)
+        error("Unexpected end of stream.");
+
+      memcpy(dst, in.data() + pos, size);
+      pos += size;
+    });
+
+    arch.decompress(in.subspan(pos), primed, out);
+  }
+
+  void compress(istream &in, ostream &out) override {
+    uint8_t header[MAX_HEADER_SIZE];
+    out.write((const char *) header, writeHeader(header));
+
+    _archiver->compress(in, out);
+  }
+
+  void decompress(istream &in, ostream &out) override {
+    archiver &arch = readHeader([&](uint8_t *dst, size_t size) {
+      if (!in.read((char *) dst, size))
+        error("Unexpected end of stream.");
+    });
+
+    arch.decompress(in, out);
+  }
+
+  size_t getHistorySize() override {
+    return _archiver->getHistorySize();
+  }
+
+  /**
+   * Returns codec by its name
+   * @param name name
+   * @return the codec
+   */
+  static codecs getCodec(const string &name) {
+    for (const codecinfo &info: CODECS)
+      if (name == info.name)
+        return info.codec;
+
+    error("Unknown codec " + name + ".");
+  }
+
+  /**
+   * Returns the codec's information
+   * @param codec codec
+   * @return the information
+   */
+  static const codecinfo &getInfo(int codec) {
+    for (const codecinfo &info: CODECS)
+      if (info.codec == codec)
+        return info;
+
+    error("Unknown codec.");
+  }
+
+  /**
+   * Checks if the codec uses more than one thread
+   * @param codec codec
+   * @return true for lz77long's parse and the codecs compressing blocks by the pipeline
+   */
+  static bool isThreaded(int codec) {
+    return codec == LZ77LONG || codec == AUTO || codec == BWT || codec == LEVEL || codec == DEDUP;
+  }
+
+  /**
+   * Creates archiver of the codec
+   * @param codec codec
+   * @param params all parameters of the codec
+   * @param threads count of threads
+   * @param budget maximal memory of compression in bytes for levels, 0 for no limit
+   * @return the archiver
+   */
+  static archiver *create(int codec, const vector<uint32_t> &params, unsigned int threads = 1, size_t budget = 0) {
+    switch (codec) {
+      case HUFFMAN:
+        return new huffman();
+      case HUFFMAN4:
+        return new huffman(true);
+      case CTXHUFFMAN:
+        return new ctxhuffman((int) params[0]);
+      case LZ77:
+        return new lz77dyn(params[0], params[1], (int) params[2]);
+      case LZ77LONG:
+        if (params[3] > lz77long::LAZY)
+          error("Invalid lz77long parse.");
+
+        return new lz77long(params[0], params[1], (int) params[2], threads, (lz77long::parses) params[3]);
+      case LZW:
+        return new lzw((int) params[0]);
+      case AUTO:
+        return new pipeline([]() { return new autoarchiver(); }, threads);
+      case BWT:
+        if (params[0] > bwt::MAX_SIZE)
+          error("Invalid bwt block size.");
+
+        return new pipeline([&]() { return new blockwise(new bwt(), params[0]); }, threads);
+      case LEVEL:
+        return new levels((int) params[0], threads, budget);
+      case DEDUP:
+        return new dedup(new levels((int) params[1], threads, budget), params[0]);
+      default:
+        error("Unknown codec.");
+    }
+  }
+
+ private:
+  unsigned int _threads;
+
+  /**
+   * Codec and parameters of the archiver
+   */
+  int _codec;
+  vector<uint32_t> _params;
+
+  unique_ptr<archiver> _archiver;
+
+  /**
+   * Codec, parameters and archiver of the last decompressed stream with other header
+   */
+  int _decoderCodec{0};
+  vector<uint32_t> _decoderParams;
+  unique_ptr<archiver> _decoder;
+
+  /**
+   * Writes the header of the codec
+   * @param header buffer of MAX_HEADER_SIZE bytes
+   * @return size of the header
+   */
+  size_t writeHeader(uint8_t *header) const {
+    memcpy(header, MAGIC, MAGIC_SIZE);
+    header[MAGIC_SIZE] = VERSION;
+    header[MAGIC_SIZE + 1] = _codec;
+    size_t count = min<size_t>(_params.size(), MAX_PARAMS);
+    header[MAGIC_SIZE + 2] = count;
+
+    for (size_t i = 0; i < count; i++)
+      writeUint32(header + MAGIC_SIZE + 3 + 4 * i, _params[i]);
+
+    return MAGIC_SIZE + 3 + 4 * count;
+  }
+
+  /**
+   * Reads the header and returns archiver of its codec
+   * @param read function which reads the given count of bytes
+   * @return the archiver
+   */
+  template<typename F>
+  archiver &readHeader(F read) {
+    uint8_t header[MAX_HEADER_SIZE];
+    read(header, MAGIC_SIZE + 3);
+
+    if (memcmp(header, MAGIC, MAGIC_SIZE) != 0)
+      error("Not an archive: invalid magic.");
+
+    if (header[MAGIC_SIZE] != VERSION)
+      error("Unsupported archive version.");
+
+    int codec = header[MAGIC_SIZE + 1];
+    unsigned int count = header[MAGIC_SIZE + 2];
+
+    if (count != getInfo(codec).count)
+      error("Invalid count of codec parameters.");
+
+    read(header + MAGIC_SIZE + 3, 4 * count);
+
+    vector<uint32_t> params(count);
+    for (unsigned int i = 0; i < count; i++)
+      params[i] = readUint32(header + MAGIC_SIZE + 3 + 4 * i);
+
+    if (codec == _codec && params == _params)
+      return *_archiver;
+
+    if (codec != _decoderCodec || params != _decoderParams) {
+      _decoder.reset(create(codec, params, _threads));
+      _decoderCodec = codec;
+      _decoderParams = params;
+    }
+
+    return *_decoder;
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_CONTAINER_HPP_
@@ -0,0 +1,200 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_CPU_HPP_
+#define HW_ARCHIVER_LIB_CPU_HPP_
+
+#include "utils.h"
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(HW_ARCHIVER_NO_DISPATCH)
+#define HW_ARCHIVER_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+/**
+ * Kernels compiled for several instruction sets in one binary: baseline, SSE4.2 and AVX2. The best set
+ * supported by the processor is selected once at startup, so the binary built for the baseline runs
+ * the wide kernels where they are available. The environment variable HW_ARCHIVER_CPU (baseline, sse4.2,
+ * avx2) selects a lower set to compare them. Without x86 or with HW_ARCHIVER_NO_DISPATCH only the baseline
+ * is built
+ */
+struct cpu {
+  /**
+   * Instruction sets in ascending order
+   */
+  enum level { BASELINE = 0, SSE42 = 1, AVX2 = 2 };
+
+  /**
+   * Kernel counting the equal leading bytes of two buffers
+   */
+  typedef size_t (*matchkernel)(const uint8_t *one, const uint8_t *two, size_t length);
+
+  /**
+   * Selected instruction set and its kernels
+   */
+  static const level selected;
+  static const matchkernel match;
+
+  /**
+   * Returns name of the instruction set
+   * @param l instruction set
+   * @return name
+   */
+  static const char *getName(level l) {
+    static const char *const NAMES[] = {"baseline", "sse4.2", "avx2"};
+    return NAMES[l];
+  }
+
+  /**
+   * Counts the equal leading bytes of two buffers, they may overlap
+   * @param one first buffer
+   * @param two second buffer
+   * @param length maximal count of bytes, both buffers have at least length bytes
+   * @return count of the equal leading bytes
+   */
+  static size_t matchLength(const uint8_t *one, const uint8_t *two, size_t length) {
+    return match(one, two, length);
+  }
+
+  /**
+   * Detects the best instruction set supported by the processor and allowed by HW_ARCHIVER_CPU
+   * @return instruction set
+   */
+  static level detect() {
+    level best = BASELINE;
+
+#ifdef HW_ARCHIVER_X86_DISPATCH
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+      best = AVX2;
+    else if (__builtin_cpu_supports("sse4.2"))
+      best = SSE42;
+#endif
+
+    const char *name = getenv("HW_ARCHIVER_CPU");
+
+    for (int l = BASELINE; name && l < best; l++) {
+      if (strcmp(name, getName((level) l)) == 0)
+        best = (level) l;
+    }
+
+    return best;
+  }
+
+  /**
+   * Returns the match kernel of the instruction set
+   * @param l instruction set
+   * @return kernel
+   */
+  static matchkernel getMatch(level l) {
+#ifdef HW_ARCHIVER_X86_DISPATCH
+    if (l == AVX2)
+      return matchLengthAvx2;
+
+    if (l == SSE42)
+      return matchLengthSse42;
+#endif
+
+    return matchLengthBaseline;
+  }
+
+  /**
+   * Returns the bits which differ in 8 bytes of two buffers
+   * @param one first buffer
+   * @param two second buffer
+   * @return differing bits, the first byte is the lowest
+   */
+  static uint64_t differ(const uint8_t *one, const uint8_t *two) {
+    uint64_t a, b;
+    memcpy(&a, one, 8);
+    memcpy(&b, two, 8);
+
+    return toLittleEndian(a) ^ toLittleEndian(b);
+  }
+
+  /**
+   * Counts the equal leading bytes by 8 bytes at once, the first difference is found by its lowest set bit
+   */
+  static size_t matchLengthBaseline(const uint8_t *one, const uint8_t *two, size_t length) {
+    size_t j = 0;
+
+    for (; j + 8 <= length; j += 8) {
+      uint64_t diff = differ(one + j, two + j);
+      if (diff != 0)
+        return j + __builtin_ctzll(diff) / 8;
+    }
+
+    while (j < length && one[j] == two[j])
+      j++;
+
+    return j;
+  }
+
+#ifdef HW_ARCHIVER_X86_DISPATCH
+  /**
+   * Counts the equal leading bytes by 16 bytes at once after the first word by the SSE4.2 string comparison
+   * (pcmpestri), the tail by the baseline
+   */
+  __attribute__((target("sse4.2"))) static size_t matchLengthSse42(const uint8_t *one, const uint8_t *two,
+                                                                    size_t length) {
+    if (length < 8)
+      return matchLengthBaseline(one, two, length);
+
+    // most candidates differ in the first bytes, one word finds it without the wide registers
+    uint64_t diff = differ(one, two);
+    if (diff != 0)
+      return __builtin_ctzll(diff) / 8;
+
+    size_t j = 8;
+
+    for (; j + 16 <= length; j += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i *) (one + j));
+      __m128i b = _mm_loadu_si128((const __m128i *) (two + j));
+
+      // index of the first differing byte, 16 if all bytes are equal
+      int index = _mm_cmpestri(a, 16, b, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY
+                                                 | _SIDD_LEAST_SIGNIFICANT);
+      if (index < 16)
+        return j + index;
+    }
+
+    return j + matchLengthBaseline(one + j, two + j, length - j);
+  }
+
+  /**
+   * Counts the equal leading bytes by 32 bytes at once after the first word, the tail by the baseline
+   */
+  __attribute__((target("avx2"))) static size_t matchLengthAvx2(const uint8_t *one, const uint8_t *two,
+                                                                 size_t length) {
+    if (length < 8)
+      return matchLengthBaseline(one, two, length);
+
+    // most candidates differ in the first bytes, one word finds it without the wide registers
+    uint64_t diff = differ(one, two);
+    if (diff != 0)
+      return __builtin_ctzll(diff) / 8;
+
+    size_t j = 8;
+
+    for (; j + 32 <= length; j += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i *) (one + j));
+      __m256i b = _mm256_loadu_si256((const __m256i *) (two + j));
+
+      unsigned int equal = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+      if (equal != 0xFFFFFFFF)
+        return j + __builtin_ctz(~equal);
+    }
+
+    return j + matchLengthBaseline(one + j, two + j, length - j);
+  }
+#endif
+};
+
+inline const cpu::level cpu::selected = cpu::detect();
+inline const cpu::matchkernel cpu::match = cpu::getMatch(cpu::selected);
+
+#endif //HW_ARCHIVER_LIB_CPU_HPP_
@@ -0,0 +1,544 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_CTXHUFFMAN_HPP_
+#define HW_ARCHIVER_LIB_CTXHUFFMAN_HPP_
+
+#include "archiver.hpp"
+#include <cmath>
+#include <queue>
+
+/**
+ * Class for Huffman compression with order-1 contexts: the previous byte selects one of a few code tables.
+ * Contexts with similar statistics are clustered to the groups by k-means over the coded size, every group
+ * has its own canonical code limited to MAX_LENGTH bits, so every byte is decoded by one table lookup.
+ * Stream: count of bytes (64 bits), count of groups - 1 (4 bits), group of every context (bits of
+ * the largest group index each), then every group's code: bitmap of coded bytes (256 bits), length of
+ * the first code (4 bits) and changes of the next lengths (1 and the direction bit per step, 0 at the end),
+ * then the codes of all bytes
+ */
+class ctxhuffman : public archiver {
+ public:
+  /**
+   * Maximal count of groups
+   */
+  static constexpr int MAX_GROUPS = 16;
+
+  /**
+   * Maximal length of codes, bits of the decoding table's index
+   */
+  static constexpr int MAX_LENGTH = 11;
+
+  /**
+   * Count of k-means iterations
+   */
+  static constexpr int ITERATIONS = 4;
+
+  /**
+   * Entry of the decoding table for unused codes
+   */
+  static constexpr uint16_t INVALID = 0x8000;
+
+  /**
+   * Count of bytes per group, smaller inputs get fewer groups so headers do not outweigh the gain
+   */
+  static constexpr size_t GROUP_SIZE = 16 * 1024;
+
+  /**
+   * Reusable working memory for compression and decompression
+   */
+  struct context {
+    /**
+     * Frequencies of bytes after every byte
+     */
+    vector<uint32_t> freqs;
+
+    /**
+     * Group of every context
+     */
+    uint8_t groups[MAX_CHAR];
+
+    /**
+     * Count of groups
+     */
+    int count;
+
+    /**
+     * Lengths of the codes of every group
+     */
+    uint8_t lengths[MAX_GROUPS][MAX_CHAR];
+
+    /**
+     * Codes of every group, the first bit of the code is its least significant one
+     */
+    uint16_t codes[MAX_GROUPS][MAX_CHAR];
+
+    /**
+     * Decoding tables of every group: byte | (code's length << 8), INVALID for unused codes
+     */
+    vector<uint16_t> tables;
+
+    context() {
+      freqs.resize(MAX_CHAR * MAX_CHAR);
+      tables.resize(MAX_GROUPS << MAX_LENGTH);
+    }
+  };
+
+  /**
+   * Default constructor
+   * @param groups maximal count of groups, from 1 to MAX_GROUPS
+   */
+  explicit ctxhuffman(int groups = MAX_GROUPS) {
+    if (groups < 1 || groups > MAX_GROUPS)
+      error("Invalid count of huffman groups.");
+
+    _groups = groups;
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    // every group's header is the bitmap and at most 2 * MAX_LENGTH + 1 bits per length,
+    // codes are at most MAX_LENGTH bits
+    size_t group = MAX_CHAR / BYTE_SIZE + 1 + MAX_CHAR * (2 * MAX_LENGTH + 1) / BYTE_SIZE;
+    return 8 + 1 + MAX_CHAR / 2 + group * MAX_GROUPS + (size * MAX_LENGTH + BYTE_SIZE - 1) / BYTE_SIZE + 1;
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    return compress(_ctx, in, out);
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    decompress(_ctx, in, out);
+  }
+
+  /**
+   * Compress buffer using given context
+   * @param ctx context
+   * @param in buffer to compress
+   * @param out buffer for compressed data
+   * @return count of compressed bytes
+   */
+  size_t compress(context &ctx, span<const uint8_t> in, span<uint8_t> out) {
+    obitbuf bout(out);
+    bout.writeData(in.size(), 64);
+
+    if (in.empty())
+      return bout.flush();
+
+    countFrequencies(ctx, in);
+    clusterContexts(ctx, (int) min<size_t>(_groups, in.size() / GROUP_SIZE + 1));
+
+    for (int g = 0; g < ctx.count; g++)
+      makeCodes(ctx, g);
+
+    writeHeader(ctx, bout);
+
+    uint8_t prev = 0;
+    for (const uint8_t &ch: in) {
+      int g = ctx.groups[prev];
+      bout.writeData(ctx.codes[g][ch], ctx.lengths[g][ch]);
+      prev = ch;
+    }
+
+    return bout.flush();
+  }
+
+  /**
+   * Decompress buffer using given context
+   * @param ctx context
+   * @param in buffer to decompress
+   * @param out output for decompressed data
+   */
+  void decompress(context &ctx, span<const uint8_t> in, obytebuf &out) {
+    ibitbuf bin(in);
+    uint64_t n = bin.readData(64);
+
+    if (n == 0) {
+      if (bin.overrun())
+        error("Unexpected end of stream.");
+      return;
+    }
+
+    // every byte takes at least one bit
+    if (n > in.size() * BYTE_SIZE)
+      error("Unexpected end of stream.");
+
+    readHeader(ctx, bin);
+
+    for (int g = 0; g < ctx.count; g++) {
+      makeCodes(ctx, g);
+      makeDecodingTable(ctx, g);
+    }
+
+    const uint16_t *tables[MAX_CHAR];
+    for (int i = 0; i < MAX_CHAR; i++)
+      tables[i] = ctx.tables.data() + ((size_t) ctx.groups[i] << MAX_LENGTH);
+
+    uint8_t *dst = out.extend(n);
+    uint8_t prev = 0;
+    uint16_t invalid = 0;
+    size_t i = 0;
+
+    // one refill loads 56 bits, enough for 5 codes
+    for (; i + 5 <= n && bin.hasMargin();) {
+      bin.refill();
+
+      for (size_t end = i + 5; i < end; i++) {
+        uint16_t entry = tables[prev][bin.peekLoaded(MAX_LENGTH)];
+        invalid |= entry;
+        // invalid entries are checked after the batch, their length bits are masked until then
+        bin.skip((entry >> BYTE_SIZE) & 0xF);
+        dst[i] = prev = (uint8_t) entry;
+      }
+
+      if (invalid & INVALID)
+        error("Invalid huffman stream.");
+    }
+
+    for (; i < n; i++) {
+      uint16_t entry = tables[prev][bin.peekData(MAX_LENGTH)];
+
+      if (entry & INVALID)
+        error("Invalid huffman stream.");
+
+      bin.skip(entry >> BYTE_SIZE);
+      dst[i] = prev = (uint8_t) entry;
+    }
+
+    if (bin.overrun() || bin.remaining() >= BYTE_SIZE)
+      error("Invalid huffman stream.");
+  }
+
+ private:
+  /**
+   * Default context
+   */
+  context _ctx;
+
+  /**
+   * Maximal count of groups
+   */
+  int _groups;
+
+  /**
+   * Counts frequencies of bytes after every byte, the first byte follows zero
+   * @param ctx context
+   * @param in input
+   */
+  static void countFrequencies(context &ctx, span<const uint8_t> in) {
+    fill(ctx.freqs.begin(), ctx.freqs.end(), 0);
+
+    uint8_t prev = 0;
+    for (const uint8_t &ch: in) {
+      ctx.freqs[prev * MAX_CHAR + ch]++;
+      prev = ch;
+    }
+  }
+
+  /**
+   * Clusters contexts to groups: the largest contexts are the seeds, then every context moves to
+   * the group whose code is the shortest for it and codes are recounted
+   * @param ctx context with frequencies
+   * @param groups maximal count of groups
+   */
+  static void clusterContexts(context &ctx, int groups) {
+    uint64_t totals[MAX_CHAR] = {};
+    int order[MAX_CHAR];
+
+    for (int x = 0; x < MAX_CHAR; x++) {
+      order[x] = x;
+      for (int c = 0; c < MAX_CHAR; c++)
+        totals[x] += ctx.freqs[x * MAX_CHAR + c];
+    }
+
+    sort(order, order + MAX_CHAR, [&](int a, int b) { return totals[a] > totals[b]; });
+
+    int count = 0;
+    while (count < groups && totals[order[count]] > 0)
+      count++;
+
+    fill(begin(ctx.groups), end(ctx.groups), 0);
+    for (int g = 0; g < count; g++)
+      ctx.groups[order[g]] = g;
+
+    vector<uint64_t> groupFreqs(count * MAX_CHAR);
+    vector<float> costs(count * MAX_CHAR);
+
+    for (int it = 0; it <= ITERATIONS; it++) {
+      // the first groups are the seeds alone, then the sums of their contexts
+      fill(groupFreqs.begin(), groupFreqs.end(), 0);
+
+      for (int x = 0; x < MAX_CHAR; x++) {
+        if (totals[x] == 0 || (it == 0 && !isSeed(order, count, x)))
+          continue;
+
+        for (int c = 0; c < MAX_CHAR; c++)
+          groupFreqs[ctx.groups[x] * MAX_CHAR + c] += ctx.freqs[x * MAX_CHAR + c];
+      }
+
+      if (it == ITERATIONS)
+        break;
+
+      // costs of bytes in bits, unseen bytes are counted as half seen
+      for (int g = 0; g < count; g++) {
+        uint64_t total = 0;
+        for (int c = 0; c < MAX_CHAR; c++)
+          total += groupFreqs[g * MAX_CHAR + c];
+
+        for (int c = 0; c < MAX_CHAR; c++)
+          costs[g * MAX_CHAR + c] = (float) log2((total + MAX_CHAR * 0.5) / (groupFreqs[g * MAX_CHAR + c] + 0.5));
+      }
+
+      for (int x = 0; x < MAX_CHAR; x++) {
+        if (totals[x] == 0)
+          continue;
+
+        float best = 0;
+        for (int g = 0; g < count; g++) {
+          float cost = 0;
+          for (int c = 0; c < MAX_CHAR; c++)
+            cost += ctx.freqs[x * MAX_CHAR + c] * costs[g * MAX_CHAR + c];
+
+          if (g == 0 || cost < best) {
+            best = cost;
+            ctx.groups[x] = g;
+          }
+        }
+      }
+    }
+
+    // empty groups are removed
+    int index[MAX_GROUPS];
+    ctx.count = 0;
+
+    for (int g = 0; g < count; g++) {
+      uint64_t total = 0;
+      for (int c = 0; c < MAX_CHAR; c++)
+        total += groupFreqs[g * MAX_CHAR + c];
+
+      index[g] = ctx.count;
+
+      if (total == 0)
+        continue;
+
+      buildLengths(&groupFreqs[g * MAX_CHAR], ctx.lengths[ctx.count]);
+      ctx.count++;
+    }
+
+    for (int x = 0; x < MAX_CHAR; x++)
+      ctx.groups[x] = totals[x] ? index[ctx.groups[x]] : 0;
+  }
+
+  /**
+   * Checks if the context is a seed of the groups
+   * @param order contexts from the largest one
+   * @param count count of seeds
+   * @param x context
+   * @return true if the context is a seed
+   */
+  static bool isSeed(const int *order, int count, int x) {
+    return find(order, order + count, x) != order + count;
+  }
+
+  /**
+   * Builds lengths of the huffman code limited to MAX_LENGTH bits, frequencies are halved until
+   * the code fits
+   * @param freqs frequencies of bytes
+   * @param lengths lengths of codes, 0 for unused bytes
+   */
+  static void buildLengths(const uint64_t *freqs, uint8_t *lengths) {
+    uint64_t weights[MAX_CHAR];
+    copy(freqs, freqs + MAX_CHAR, weights);
+
+    while (true) {
+      // nodes: leaves are bytes, internal nodes follow them
+      int parents[2 * MAX_CHAR];
+      priority_queue<pair<uint64_t, int>, vector<pair<uint64_t, int>>, greater<pair<uint64_t, int>>> heap;
+
+      for (int c = 0; c < MAX_CHAR; c++)
+        if (weights[c])
+          heap.emplace(weights[c], c);
+
+      if (heap.size() == 1) {
+        fill(lengths, lengths + MAX_CHAR, 0);
+        lengths[heap.top().second] = 1;
+        return;
+      }
+
+      int next = MAX_CHAR;
+      while (heap.size() > 1) {
+        auto a = heap.top();
+        heap.pop();
+        auto b = heap.top();
+        heap.pop();
+
+        parents[a.second] = parents[b.second] = next;
+        heap.emplace(a.first + b.first, next++);
+      }
+
+      int root = next - 1;
+      int maxLength = 0;
+
+      for (int i = next - 1; i >= 0; i--) {
+        if (i < MAX_CHAR && !weights[i])
+          continue;
+
+        int depth = 0;
+        for (int node = i; node != root; node = parents[node])
+          depth++;
+
+        if (i < MAX_CHAR) {
+          lengths[i] = depth;
+          maxLength = max(maxLength, depth);
+        }
+      }
+
+      for (int c = 0; c < MAX_CHAR; c++)
+        if (!weights[c])
+          lengths[c] = 0;
+
+      if (maxLength <= MAX_LENGTH)
+        return;
+
+      for (uint64_t &weight: weights)
+        if (weight)
+          weight = weight / 2 + 1;
+    }
+  }
+
+  /**
+   * Makes canonical codes of the group by the lengths
+   * @param ctx context with the lengths
+   * @param g group
+   */
+  static void makeCodes(context &ctx, int g) {
+    int counts[MAX_LENGTH + 1] = {};
+    for (int c = 0; c < MAX_CHAR; c++)
+      counts[ctx.lengths[g][c]]++;
+
+    uint32_t next[MAX_LENGTH + 1];
+    uint32_t code = 0;
+    counts[0] = 0;
+
+    for (int len = 1; len <= MAX_LENGTH; len++) {
+      code = (code + counts[len - 1]) << 1;
+      next[len] = code;
+    }
+
+    for (int c = 0; c < MAX_CHAR; c++) {
+      int len = ctx.lengths[g][c];
+
+      if (len)
+        ctx.codes[g][c] = reverseBits(next[len]++, len);
+    }
+  }
+
+  /**
+   * Fills the decoding table of the group
+   * @param ctx context with the codes
+   * @param g group
+   */
+  static void makeDecodingTable(context &ctx, int g) {
+    uint16_t *table = ctx.tables.data() + ((size_t) g << MAX_LENGTH);
+    fill(table, table + (1 << MAX_LENGTH), INVALID);
+
+    for (int c = 0; c < MAX_CHAR; c++) {
+      int len = ctx.lengths[g][c];
+
+      if (!len)
+        continue;
+
+      for (uint32_t i = ctx.codes[g][c]; i < (1u << MAX_LENGTH); i += 1u << len)
+        table[i] = c | (len << BYTE_SIZE);
+    }
+  }
+
+  /**
+   * Writes groups of contexts and lengths of codes
+   * @param ctx context
+   * @param bout bitbuf
+   */
+  static void writeHeader(const context &ctx, obitbuf &bout) {
+    bout.writeData(ctx.count - 1, 4);
+
+    int bits = countBits(ctx.count - 1);
+    for (const uint8_t &group: ctx.groups)
+      bout.writeData(group, bits);
+
+    for (int g = 0; g < ctx.count; g++) {
+      for (const uint8_t &len: ctx.lengths[g])
+        bout.writeBit(len != 0);
+
+      int curr = -1;
+      for (const uint8_t &len: ctx.lengths[g]) {
+        if (!len)
+          continue;
+
+        if (curr < 0) {
+          bout.writeData(len, 4);
+        } else {
+          for (; curr != len; curr += curr < len ? 1 : -1)
+            bout.writeData(curr < len ? 0b01 : 0b11, 2);
+          bout.writeBit(false);
+        }
+
+        curr = len;
+      }
+    }
+  }
+
+  /**
+   * Reads groups of contexts and lengths of codes
+   * @param ctx context
+   * @param bin bitbuf
+   */
+  static void readHeader(context &ctx, ibitbuf &bin) {
+    ctx.count = (int) bin.readData(4) + 1;
+
+    int bits = countBits(ctx.count - 1);
+    for (uint8_t &group: ctx.groups) {
+      group = bin.readData(bits);
+
+      if (group >= ctx.count)
+        error("Invalid huffman header.");
+    }
+
+    for (int g = 0; g < ctx.count; g++) {
+      for (uint8_t &len: ctx.lengths[g])
+        len = bin.readData(1);
+
+      int curr = -1;
+      uint32_t kraft = 0;
+
+      for (uint8_t &len: ctx.lengths[g]) {
+        if (!len)
+          continue;
+
+        if (curr < 0) {
+          curr = bin.readData(4);
+        } else {
+          while (bin.readData(1)) {
+            curr += bin.readData(1) ? -1 : 1;
+
+            if (curr < 1 || curr > MAX_LENGTH || bin.overrun())
+              error("Invalid huffman header.");
+          }
+        }
+
+        if (curr < 1 || curr > MAX_LENGTH)
+          error("Invalid huffman header.");
+
+        len = curr;
+        kraft += 1u << (MAX_LENGTH - len);
+      }
+
+      if (kraft > (1u << MAX_LENGTH) || bin.overrun())
+        error("Invalid huffman header.");
+    }
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_CTXHUFFMAN_HPP_
@@ -0,0 +1,355 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_DEDUP_HPP_
+#define HW_ARCHIVER_LIB_DEDUP_HPP_
+
+#include "archiver.hpp"
+#include <memory>
+
+/**
+ * Table of random values for the Gear rolling hash
+ */
+struct geartable {
+  uint64_t values[MAX_CHAR];
+
+  /**
+   * Fills the table by splitmix64 generator, so it is the same on every platform
+   */
+  constexpr geartable() : values() {
+    uint64_t x = 0x2545F4914F6CDD1DULL;
+
+    for (int i = 0; i < MAX_CHAR; i++) {
+      x += 0x9E3779B97F4A7C15ULL;
+      uint64_t z = x;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      values[i] = z ^ (z >> 31);
+    }
+  }
+};
+
+/**
+ * Gear values
+ */
+static constexpr geartable GEAR{};
+
+/**
+ * Content defined chunker (FastCDC): boundaries depend only on the nearby bytes, so inserting or removing
+ * bytes moves only the boundaries around them and repeated contents are split into the same chunks
+ */
+class chunker {
+ public:
+  /**
+   * Default constructor
+   * @param avgBits binary logarithm of the average chunk's size
+   */
+  explicit chunker(unsigned int avgBits = 13) {
+    _avg = (size_t) 1 << avgBits;
+    _min = _avg / 4;
+    _max = _avg * 8;
+
+    // normalized chunking: harder to cut before the average size and easier after it
+    _maskS = lowMask(avgBits + 2) << (64 - avgBits - 2);
+    _maskL = lowMask(avgBits - 2) << (64 - avgBits + 2);
+  }
+
+  /**
+   * Finds and returns the size of the next chunk
+   * @param contents contents starting with the chunk
+   * @return the size of the chunk
+   */
+  size_t cut(span<const uint8_t> contents) const {
+    size_t n = contents.size();
+
+    if (n <= _min)
+      return n;
+
+    size_t normal = min(_avg, n), limit = min(_max, n);
+    uint64_t fp = 0;
+    size_t i = _min;
+
+    for (; i < normal; i++) {
+      fp = (fp << 1) + GEAR.values[contents[i]];
+      if (!(fp & _maskS))
+        return i + 1;
+    }
+
+    for (; i < limit; i++) {
+      fp = (fp << 1) + GEAR.values[contents[i]];
+      if (!(fp & _maskL))
+        return i + 1;
+    }
+
+    return limit;
+  }
+
+  /**
+   * Returns the minimal chunk's size
+   * @return the minimal chunk's size
+   */
+  size_t minSize() const {
+    return _min;
+  }
+
+ private:
+  size_t _avg, _min, _max;
+  uint64_t _maskS, _maskL;
+};
+
+/**
+ * Counts and returns fingerprint of the chunk
+ * @param data chunk
+ * @return fingerprint
+ */
+static uint64_t fingerprint(span<const uint8_t> data) {
+  uint64_t h = 0x9E3779B97F4A7C15ULL ^ data.size();
+  size_t i = 0;
+
+  for (; i + 8 <= data.size(); i += 8) {
+    uint64_t word;
+    memcpy(&word, data.data() + i, sizeof(word));
+    h = (h ^ (toLittleEndian(word) * 0xBF58476D1CE4E5B9ULL)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+  }
+
+  for (; i < data.size(); i++)
+    h = (h ^ data[i]) * 0x100000001B3ULL;
+
+  return h ^ (h >> 29);
+}
+
+/**
+ * Archiver which removes repeated chunks before compression: the input is split into content defined
+ * chunks, every unique chunk is compressed once by the inner archiver and repeats are stored as references.
+ * Stream: count of chunks, for every chunk its size (new chunk) or index of the unique chunk (repeat),
+ * then the inner archiver's stream of the unique chunks
+ */
+class dedup : public archiver {
+ public:
+  /**
+   * Reusable memory of the fingerprint store and buffers, after the first call of the same size
+   * compression and decompression do not allocate
+   */
+  struct context {
+    /**
+     * Fingerprint store: open addressing table of unique chunk indices, -1 for the empty cell
+     */
+    vector<int64_t> table;
+
+    /**
+     * Fingerprint of every unique chunk
+     */
+    vector<uint64_t> fingerprints;
+
+    /**
+     * Offset of every unique chunk in the input (compression) or in the unique chunks (decompression)
+     */
+    vector<uint64_t> offsets;
+
+    /**
+     * Size of every unique chunk
+     */
+    vector<uint64_t> sizes;
+
+    /**
+     * Descriptor of every chunk: (size << 1) for new chunks, (index << 1) | 1 for repeats
+     */
+    vector<uint64_t> chunks;
+
+    /**
+     * Unique chunks
+     */
+    vector<uint8_t> unique;
+
+    /**
+     * Forgets all chunks
+     * @param maxChunks maximal count of chunks
+     */
+    void reset(size_t maxChunks) {
+      fingerprints.clear();
+      offsets.clear();
+      sizes.clear();
+      chunks.clear();
+      unique.clear();
+      table.assign((size_t) 1 << countBits(2 * maxChunks), -1);
+    }
+  };
+
+  /**
+   * Limits of the binary logarithm of the average chunk's size
+   */
+  static constexpr unsigned int MIN_BITS = 6;
+  static constexpr unsigned int MAX_BITS = 24;
+
+  /**
+   * Default constructor
+   * @param inner archiver for unique chunks, owned by dedup
+   * @param avgBits binary logarithm of the average chunk's size, from MIN_BITS to MAX_BITS
+   */
+  explicit dedup(archiver *inner, unsigned int avgBits = 13) : _inner(inner), _chunker(avgBits) {
+    if (avgBits < MIN_BITS || avgBits > MAX_BITS)
+      error("Invalid dedup chunk size.");
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    // every chunk descriptor takes at most 10 bytes
+    return _inner->compressBound(size) + 10 * (size / _chunker.minSize() + 2);
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    return compress(_ctx, in, out);
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    decompress(_ctx, in, out);
+  }
+
+  /**
+   * Compress buffer using given context
+   * @param ctx context
+   * @param in buffer to compress
+   * @param out buffer for compressed data
+   * @return count of compressed bytes
+   */
+  size_t compress(context &ctx, span<const uint8_t> in, span<uint8_t> out) {
+    ctx.reset(in.size() / _chunker.minSize() + 1);
+
+    for (size_t pos = 0; pos < in.size();) {
+      span<const uint8_t> chunk = in.subspan(pos, _chunker.cut(in.subspan(pos)));
+      uint64_t fp = fingerprint(chunk);
+      int64_t index = findChunk(ctx, in, chunk, fp);
+
+      if (index >= 0) {
+        ctx.chunks.push_back(((uint64_t) index << 1) | 1);
+      } else {
+        addChunk(ctx, pos, chunk, fp);
+        ctx.chunks.push_back((uint64_t) chunk.size() << 1);
+      }
+
+      pos += chunk.size();
+    }
+
+    obitbuf bout(out);
+    writeVarint(bout, ctx.chunks.size());
+
+    for (const uint64_t &chunk: ctx.chunks)
+      writeVarint(bout, chunk);
+
+    size_t size = bout.flush();
+
+    return size + _inner->compress(ctx.unique, out.subspan(size));
+  }
+
+  /**
+   * Decompress buffer using given context
+   * @param ctx context
+   * @param in buffer to decompress
+   * @param out output for decompressed data
+   */
+  void decompress(context &ctx, span<const uint8_t> in, obytebuf &out) {
+    size_t pos = 0;
+    uint64_t count = readVarint(in, pos);
+
+    if (count > in.size())
+      error("Invalid dedup stream.");
+
+    ctx.reset(0);
+
+    for (uint64_t i = 0; i < count; i++)
+      ctx.chunks.push_back(readVarint(in, pos));
+
+    _inner->decompress(in.subspan(pos), ctx.unique);
+
+    uint64_t offset = 0;
+
+    for (const uint64_t &chunk: ctx.chunks) {
+      if (chunk & 1) {
+        uint64_t index = chunk >> 1;
+
+        if (index >= ctx.offsets.size())
+          error("Invalid dedup chunk reference.");
+
+        out.write(ctx.unique.data() + ctx.offsets[index], ctx.sizes[index]);
+      } else {
+        uint64_t size = chunk >> 1;
+
+        if (size > ctx.unique.size() - offset)
+          error("Invalid dedup chunk size.");
+
+        ctx.offsets.push_back(offset);
+        ctx.sizes.push_back(size);
+        out.write(ctx.unique.data() + offset, size);
+        offset += size;
+      }
+    }
+
+    if (offset != ctx.unique.size())
+      error("Invalid dedup stream.");
+  }
+
+ private:
+  /**
+   * Archiver for unique chunks
+   */
+  unique_ptr<archiver> _inner;
+
+  /**
+   * Chunker
+   */
+  chunker _chunker;
+
+  /**
+   * Default context
+   */
+  context _ctx;
+
+  /**
+   * Finds the same chunk among the unique ones, chunks with equal fingerprints are compared byte by byte
+   * @param ctx context
+   * @param in input
+   * @param chunk chunk
+   * @param fp fingerprint of the chunk
+   * @return index of the unique chunk or -1 if it was not found
+   */
+  int64_t findChunk(const context &ctx, span<const uint8_t> in, span<const uint8_t> chunk, uint64_t fp) const {
+    size_t mask = ctx.table.size() - 1;
+
+    for (size_t cell = fp & mask; ctx.table[cell] >= 0; cell = (cell + 1) & mask) {
+      int64_t index = ctx.table[cell];
+
+      if (ctx.fingerprints[index] == fp && ctx.sizes[index] == chunk.size()
+          && memcmp(in.data() + ctx.offsets[index], chunk.data(), chunk.size()) == 0)
+        return index;
+    }
+
+    return -1;
+  }
+
+  /**
+   * Adds unique chunk
+   * @param ctx context
+   * @param offset offset of the chunk in the input
+   * @param chunk chunk
+   * @param fp fingerprint of the chunk
+   */
+  void addChunk(context &ctx, uint64_t offset, span<const uint8_t> chunk, uint64_t fp) {
+    size_t mask = ctx.table.size() - 1;
+    size_t cell = fp & mask;
+
+    while (ctx.table[cell] >= 0)
+      cell = (cell + 1) & mask;
+
+    ctx.table[cell] = ctx.fingerprints.size();
+    ctx.fingerprints.push_back(fp);
+    ctx.offsets.push_back(offset);
+    ctx.sizes.push_back(chunk.size());
+    ctx.unique.insert(ctx.unique.end(), chunk.begin(), chunk.end());
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_DEDUP_HPP_
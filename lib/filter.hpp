@@ -0,0 +1,336 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_FILTER_HPP_
+#define HW_ARCHIVER_LIB_FILTER_HPP_
+
+#include "archiver.hpp"
+#include <memory>
+
+/**
+ * Archiver which transforms the input by a reversible filter before the inner archiver:
+ * x86 filter converts relative addresses of CALL and JMP instructions to absolute ones, so calls of the same
+ * function become equal bytes; delta filter replaces every byte by its difference from the byte `stride`
+ * bytes before, so smooth pixels and numbers of tables become small repeated values. The filter is chosen by
+ * the input's content: executable and bitmap headers, then the density of x86 calls, then the entropy
+ * of the deltas of a sample. Stream: filter (1 byte), stride (1 byte), the inner archiver's stream
+ */
+class filter : public archiver {
+ public:
+  /**
+   * Filters
+   */
+  enum filters { NONE = 0, X86 = 1, DELTA = 2, AUTO = 255 };
+
+  /**
+   * Maximal stride of the delta filter
+   */
+  static constexpr unsigned int MAX_STRIDE = 16;
+
+  /**
+   * Size of the sample for sniffing the content
+   */
+  static constexpr size_t SAMPLE_SIZE = 64 * 1024;
+
+  /**
+   * Size of the header
+   */
+  static constexpr unsigned int HEADER_SIZE = 2;
+
+  /**
+   * Default constructor
+   * @param inner archiver for the filtered data, owned by filter
+   * @param method filter, by default it is chosen by the content
+   * @param stride stride of the delta filter, by default it is chosen by the content
+   */
+  explicit filter(archiver *inner, filters method = AUTO, unsigned int stride = 0) : _inner(inner) {
+    if (stride > MAX_STRIDE || (method == DELTA && stride == 0))
+      error("Invalid filter stride.");
+
+    _method = method;
+    _stride = stride;
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    return HEADER_SIZE + _inner->compressBound(size);
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    if (out.size() < HEADER_SIZE)
+      error("Output buffer is too small.");
+
+    filters method = _method;
+    unsigned int stride = _stride;
+
+    if (method == AUTO)
+      method = sniff(in, stride);
+    else if (method == DELTA && stride == 0)
+      stride = chooseStride(in.subspan(0, min(in.size(), SAMPLE_SIZE)));
+
+    if (method == NONE)
+      stride = 0;
+
+    out[0] = method;
+    out[1] = stride;
+
+    if (method == NONE)
+      return HEADER_SIZE + _inner->compress(in, out.subspan(HEADER_SIZE));
+
+    _buffer.resize(in.size());
+
+    if (method == X86)
+      encodeX86(in.data(), _buffer.data(), in.size());
+    else
+      encodeDelta(in.data(), _buffer.data(), in.size(), stride);
+
+    return HEADER_SIZE + _inner->compress(_buffer, out.subspan(HEADER_SIZE));
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    if (in.size() < HEADER_SIZE)
+      error("Unexpected end of stream.");
+
+    uint8_t method = in[0];
+    unsigned int stride = in[1];
+
+    if (method > DELTA || (method == DELTA) != (stride > 0) || stride > MAX_STRIDE)
+      error("Invalid filter header.");
+
+    if (method == NONE) {
+      _inner->decompress(in.subspan(HEADER_SIZE), out);
+      return;
+    }
+
+    _inner->decompress(in.subspan(HEADER_SIZE), _buffer);
+    uint8_t *dst = out.extend(_buffer.size());
+
+    if (method == X86)
+      decodeX86(_buffer.data(), dst, _buffer.size());
+    else
+      decodeDelta(_buffer.data(), dst, _buffer.size(), stride);
+  }
+
+  /**
+   * Chooses the filter by the content
+   * @param in input
+   * @param stride stride of the delta filter
+   * @return the filter
+   */
+  static filters sniff(span<const uint8_t> in, unsigned int &stride) {
+    stride = 0;
+
+    // DOS/Windows and ELF executables
+    if (hasMagic(in, "MZ") || hasMagic(in, "\x7F" "ELF"))
+      return X86;
+
+    // bitmaps with whole bytes per pixel, their bits per pixel are at the offset 28
+    if (hasMagic(in, "BM") && in.size() >= 30) {
+      unsigned int bits = in[28] | (in[29] << 8);
+
+      if (bits >= 2 * BYTE_SIZE && bits % BYTE_SIZE == 0 && bits / BYTE_SIZE <= MAX_STRIDE) {
+        stride = bits / BYTE_SIZE;
+        return DELTA;
+      }
+    }
+
+    // the middle of the input is less likely to be a header
+    size_t size = min(in.size(), SAMPLE_SIZE);
+    span<const uint8_t> sample = in.subspan((in.size() - size) / 2, size);
+
+    if (countCalls(sample) * X86_DENSITY > sample.size())
+      return X86;
+
+    stride = chooseStride(sample);
+
+    return stride ? DELTA : NONE;
+  }
+
+ private:
+  /**
+   * Archiver for the filtered data
+   */
+  unique_ptr<archiver> _inner;
+
+  filters _method;
+  unsigned int _stride;
+
+  /**
+   * Filtered data
+   */
+  vector<uint8_t> _buffer;
+
+  /**
+   * Code is detected by at least one call per X86_DENSITY bytes, random data has one per 16K bytes
+   */
+  static constexpr size_t X86_DENSITY = 512;
+
+  /**
+   * Delta filter is used if it lowers the entropy by DELTA_GAIN at least
+   */
+  static constexpr double DELTA_GAIN = 0.1;
+
+  /**
+   * Checks if the input starts with the magic bytes
+   * @param in input
+   * @param magic magic bytes
+   * @return true if the input starts with them
+   */
+  static bool hasMagic(span<const uint8_t> in, const char *magic) {
+    size_t size = strlen(magic);
+
+    return in.size() >= size && memcmp(in.data(), magic, size) == 0;
+  }
+
+  /**
+   * Checks if the byte is the opcode of CALL (E8) or JMP (E9) with 4 bytes operand
+   * @param opcode byte
+   * @return true if it is the opcode
+   */
+  static bool isCall(uint8_t opcode) {
+    return (opcode & 0xFE) == 0xE8;
+  }
+
+  /**
+   * Checks if the address is near: its high byte is 00 or FF, the converted address is near as well
+   * @param p the address
+   * @return true if it is near
+   */
+  static bool isNear(const uint8_t *p) {
+    return (uint8_t) (p[3] + 1) <= 1;
+  }
+
+  /**
+   * Counts near calls and jumps
+   * @param in input
+   * @return count of calls
+   */
+  static size_t countCalls(span<const uint8_t> in) {
+    size_t calls = 0;
+
+    for (size_t i = 0; i + 5 <= in.size(); i++)
+      if (isCall(in[i])) {
+        calls += isNear(in.data() + i + 1);
+        i += 4;
+      }
+
+    return calls;
+  }
+
+  /**
+   * Converts the address to 25 bits signed number, so its high byte is 00 or FF
+   * @param address address
+   * @return converted address
+   */
+  static uint32_t toNear(uint32_t address) {
+    return (address & 0x01000000) ? address | 0xFF000000 : address & 0x00FFFFFF;
+  }
+
+  /**
+   * Converts relative addresses of near calls and jumps to absolute ones (offsets in the input)
+   * @param src input
+   * @param dst output, n bytes
+   * @param n count of bytes
+   */
+  static void encodeX86(const uint8_t *src, uint8_t *dst, size_t n) {
+    if (n == 0)
+      return;
+
+    memcpy(dst, src, n);
+
+    for (size_t i = 0; i + 5 <= n; i++) {
+      if (!isCall(dst[i]))
+        continue;
+
+      if (isNear(dst + i + 1))
+        writeUint32(dst + i + 1, toNear(readUint32(dst + i + 1) + (uint32_t) (i + 5)));
+      i += 4;
+    }
+  }
+
+  /**
+   * Restores relative addresses of near calls and jumps. Operands of all calls are skipped, so calls
+   * are found at the same positions, and converted addresses are near as the original ones
+   * @param src filtered input
+   * @param dst output, n bytes
+   * @param n count of bytes
+   */
+  static void decodeX86(const uint8_t *src, uint8_t *dst, size_t n) {
+    if (n == 0)
+      return;
+
+    memcpy(dst, src, n);
+
+    for (size_t i = 0; i + 5 <= n; i++) {
+      if (!isCall(dst[i]))
+        continue;
+
+      if (isNear(dst + i + 1))
+        writeUint32(dst + i + 1, toNear(readUint32(dst + i + 1) - (uint32_t) (i + 5)));
+      i += 4;
+    }
+  }
+
+  /**
+   * Replaces every byte by its difference from the byte stride bytes before
+   * @param src input
+   * @param dst output, n bytes
+   * @param n count of bytes
+   * @param stride stride
+   */
+  static void encodeDelta(const uint8_t *src, uint8_t *dst, size_t n, unsigned int stride) {
+    for (size_t i = 0; i < n; i++)
+      dst[i] = i < stride ? src[i] : src[i] - src[i - stride];
+  }
+
+  /**
+   * Restores bytes from their differences
+   * @param src differences
+   * @param dst output, n bytes
+   * @param n count of bytes
+   * @param stride stride
+   */
+  static void decodeDelta(const uint8_t *src, uint8_t *dst, size_t n, unsigned int stride) {
+    for (size_t i = 0; i < n; i++)
+      dst[i] = i < stride ? src[i] : src[i] + dst[i - stride];
+  }
+
+  /**
+   * Chooses the stride of the delta filter by the entropy of the deltas of the sample
+   * @param sample sample
+   * @return the stride or 0 if deltas do not lower the entropy
+   */
+  static unsigned int chooseStride(span<const uint8_t> sample) {
+    int freqs[MAX_CHAR] = {};
+
+    if (sample.size() < 2 * MAX_STRIDE)
+      return 0;
+
+    for (const uint8_t &ch: sample)
+      freqs[ch]++;
+
+    double best = getEntropy(freqs, sample.size()) * (1 - DELTA_GAIN);
+    unsigned int stride = 0;
+
+    for (unsigned int s = 1; s <= 4; s++) {
+      fill(begin(freqs), end(freqs), 0);
+
+      for (size_t i = s; i < sample.size(); i++)
+        freqs[(uint8_t) (sample[i] - sample[i - s])]++;
+
+      double entropy = getEntropy(freqs, sample.size() - s);
+
+      if (entropy < best) {
+        best = entropy;
+        stride = s;
+      }
+    }
+
+    return stride;
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_FILTER_HPP_
@@ -0,0 +1,457 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_FRAMES_HPP_
+#define HW_ARCHIVER_LIB_FRAMES_HPP_
+
+#include "container.hpp"
+#include <filesystem>
+
+/**
+ * Archive file of frames which are appended without recompressing the earlier ones. Every frame is the container
+ * stream of its contents, so frames of one archive may use different codecs. A frame is decompressed alone,
+ * or after the previous frame if it is primed: its stream then references the previous frame's last bytes
+ * as the lz77 window or the LZW dictionary, which helps small increments of similar data. Every MAX_CHAIN frames
+ * or MAX_CHAIN_SIZE bytes of contents a frame is decompressed alone even if it is primed, so appending and reading
+ * one frame decompress at most one bounded chain of frames instead of all earlier ones. The index at the end
+ * of the file lists all frames, so the last frames are found without reading the others. Appending writes
+ * the new frame over the old index and then the new index, so if it is interrupted, the frames are found
+ * by reading their headers from the beginning and the incomplete tail is dropped by the next append.
+ * Frame: magic "HWFR", size of the history (4 bytes), size of the contents (8 bytes), size of the payload
+ * (8 bytes), xxHash64 of the contents (8 bytes), payload.
+ * Index: magic "HWIX", count of frames (4 bytes), for every frame its offset (8 bytes), size of the contents
+ * (8 bytes) and size of the history (4 bytes), offset of the index (8 bytes), magic "HWIX".
+ * All numbers are little endian
+ */
+class frames {
+ public:
+  /**
+   * Magic bytes of frames and of the index
+   */
+  static constexpr char FRAME_MAGIC[] = "HWFR";
+  static constexpr char INDEX_MAGIC[] = "HWIX";
+
+  static constexpr unsigned int MAGIC_SIZE = 4;
+
+  /**
+   * Size of the frame's header
+   */
+  static constexpr unsigned int HEADER_SIZE = MAGIC_SIZE + 4 + 8 + 8 + 8;
+
+  /**
+   * Size of the index's entry of every frame
+   */
+  static constexpr unsigned int ENTRY_SIZE = 8 + 8 + 4;
+
+  /**
+   * Size of the index without entries
+   */
+  static constexpr unsigned int INDEX_SIZE = MAGIC_SIZE + 4 + 8 + MAGIC_SIZE;
+
+  /**
+   * Maximal count of frames and of their contents' bytes decompressed for one primed frame
+   */
+  static constexpr size_t MAX_CHAIN = 16;
+  static constexpr uint64_t MAX_CHAIN_SIZE = 1 << 28;
+
+  /**
+   * Frame of the archive
+   */
+  struct frame {
+    /**
+     * Offset of the frame in the file
+     */
+    uint64_t offset;
+
+    /**
+     * Offset of the frame's contents in the contents of all frames
+     */
+    uint64_t position;
+
+    /**
+     * Size of the contents
+     */
+    uint64_t size;
+
+    /**
+     * Size of the payload
+     */
+    uint64_t payloadSize;
+
+    /**
+     * Count of the previous frame's last bytes referenced by the stream, 0 if the frame is decompressed alone
+     */
+    uint32_t history;
+  };
+
+  /**
+   * Default constructor, opens the archive
+   * @param fileName archive's filename
+   * @param writable true for appending, the empty archive is created if the file does not exist
+   */
+  explicit frames(const string &fileName, bool writable = false) {
+    _fileName = fileName;
+    _writable = writable;
+
+    // the file is created if it does not exist, without touching it otherwise
+    if (writable)
+      ofstream(fileName, ios::out | ios::binary | ios::app);
+
+    open();
+    load();
+  }
+
+  /**
+   * Returns the frames
+   * @return the frames
+   */
+  const vector<frame> &getFrames() const {
+    return _frames;
+  }
+
+  /**
+   * Returns size of the contents of all frames
+   * @return count of bytes
+   */
+  uint64_t getSize() const {
+    return _frames.empty() ? 0 : _frames.back().position + _frames.back().size;
+  }
+
+  /**
+   * Returns the frame holding the position of the contents
+   * @param position position, less than getSize()
+   * @return index of the frame
+   */
+  size_t find(uint64_t position) const {
+    if (position >= getSize())
+      error("Position is out of the archive.");
+
+    auto it = upper_bound(_frames.begin(), _frames.end(), position, [](uint64_t p, const frame &f) {
+      return p < f.position;
+    });
+
+    return it - _frames.begin() - 1;
+  }
+
+  /**
+   * Appends the frame
+   * @param data contents of the frame
+   * @param arch archiver of the frame
+   * @param primed true for referencing the previous frame's contents, if the codec supports it
+   */
+  void append(span<const uint8_t> data, container &arch, bool primed = false) {
+    if (!_writable)
+      error("Archive " + _fileName + " is opened for reading.");
+
+    vector<uint8_t> buffer;
+    size_t history = 0;
+
+    if (primed && !_frames.empty() && arch.getHistorySize() > 0 && !isChainFull()) {
+      read(_frames.size() - 1, buffer);
+
+      history = min<size_t>({buffer.size(), arch.getHistorySize(), UINT32_MAX});
+      buffer.erase(buffer.begin(), buffer.end() - history);
+    }
+
+    buffer.insert(buffer.end(), data.begin(), data.end());
+
+    vector<uint8_t> payload(HEADER_SIZE + arch.compressBound(data.size()));
+    size_t payloadSize = arch.compress(buffer, history, span<uint8_t>(payload).subspan(HEADER_SIZE));
+
+    uint8_t *header = payload.data();
+    memcpy(header, FRAME_MAGIC, MAGIC_SIZE);
+    writeUint32(header + MAGIC_SIZE, history);
+    writeUint64(header + MAGIC_SIZE + 4, data.size());
+    writeUint64(header + MAGIC_SIZE + 12, payloadSize);
+    writeUint64(header + MAGIC_SIZE + 20, xxhash64::hash(data));
+
+    _frames.push_back({_end, getSize(), data.size(), payloadSize, (uint32_t) history});
+
+    _file.clear();
+    _file.seekp(_end);
+    _file.write((const char *) payload.data(), HEADER_SIZE + payloadSize);
+    _end += HEADER_SIZE + payloadSize;
+
+    writeIndex();
+  }
+
+  /**
+   * Decompresses the frame, primed frames are decompressed after the previous ones
+   * @param index index of the frame
+   * @param out contents of the frame
+   */
+  void read(size_t index, vector<uint8_t> &out) {
+    if (index >= _frames.size())
+      error("Invalid frame index.");
+
+    size_t first = getChainStart(index);
+    vector<uint8_t> previous;
+
+    for (size_t i = first; i <= index; i++) {
+      decompressFrame(i, previous, out);
+      swap(previous, out);
+    }
+
+    swap(previous, out);
+  }
+
+  /**
+   * Decompresses the frames from the first one to the end to the stream
+   * @param first index of the first frame
+   * @param out stream
+   */
+  void extract(size_t first, ostream &out) {
+    if (first > _frames.size())
+      error("Invalid frame index.");
+
+    size_t start = first < _frames.size() ? getChainStart(first) : first;
+    vector<uint8_t> previous, contents;
+
+    for (size_t i = start; i < _frames.size(); i++) {
+      decompressFrame(i, previous, contents);
+
+      if (i >= first)
+        out.write((const char *) contents.data(), contents.size());
+
+      swap(previous, contents);
+    }
+  }
+
+ private:
+  string _fileName;
+
+  bool _writable;
+
+  fstream _file;
+
+  vector<frame> _frames;
+
+  /**
+   * Offset after the last frame, where the index starts
+   */
+  uint64_t _end{0};
+
+  /**
+   * Archiver which decompresses frames of any codec
+   */
+  container _decoder;
+
+  /**
+   * Returns the first frame of the chain, which is decompressed alone
+   * @param index index of the frame
+   * @return index of the first frame
+   */
+  size_t getChainStart(size_t index) const {
+    while (_frames[index].history > 0)
+      index--;
+
+    return index;
+  }
+
+  /**
+   * Checks if the next frame has to be decompressed alone to bound the chain of the last frame
+   * @return true if the chain has MAX_CHAIN frames or MAX_CHAIN_SIZE bytes
+   */
+  bool isChainFull() const {
+    size_t first = getChainStart(_frames.size() - 1);
+
+    return _frames.size() - first >= MAX_CHAIN || getSize() - _frames[first].position >= MAX_CHAIN_SIZE;
+  }
+
+  /**
+   * Opens the file for reading, and for writing if the archive is writable
+   */
+  void open() {
+    _file.open(_fileName, _writable ? ios::in | ios::out | ios::binary : ios::in | ios::binary);
+
+    if (!_file)
+      error("Cannot open " + _fileName + ".");
+  }
+
+  /**
+   * Reads bytes at the offset
+   * @param offset offset
+   * @param dst buffer
+   * @param size count of bytes
+   * @return false if the file is shorter
+   */
+  bool readAt(uint64_t offset, uint8_t *dst, size_t size) {
+    _file.clear();
+    _file.seekg(offset);
+
+    return (bool) _file.read((char *) dst, size);
+  }
+
+  /**
+   * Loads the index, or finds the frames by their headers if the index is missing or invalid
+   */
+  void load() {
+    _file.seekg(0, ios::end);
+    uint64_t fileSize = _file.tellg();
+
+    if (fileSize == 0 || loadIndex(fileSize))
+      return;
+
+    scan(fileSize);
+  }
+
+  /**
+   * Loads the index from the end of the file
+   * @param fileSize size of the file
+   * @return false if the index is missing or invalid
+   */
+  bool loadIndex(uint64_t fileSize) {
+    uint8_t end[8 + MAGIC_SIZE];
+
+    if (fileSize < INDEX_SIZE || !readAt(fileSize - sizeof(end), end, sizeof(end)))
+      return false;
+
+    uint64_t offset = readUint64(end);
+
+    if (memcmp(end + 8, INDEX_MAGIC, MAGIC_SIZE) != 0 || offset > fileSize - INDEX_SIZE)
+      return false;
+
+    vector<uint8_t> index(fileSize - offset);
+
+    if (!readAt(offset, index.data(), index.size()) || memcmp(index.data(), INDEX_MAGIC, MAGIC_SIZE) != 0)
+      return false;
+
+    uint32_t count = readUint32(index.data() + MAGIC_SIZE);
+
+    if (index.size() != INDEX_SIZE + (uint64_t) count * ENTRY_SIZE)
+      return false;
+
+    vector<frame> loaded;
+    uint64_t position = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+      const uint8_t *entry = index.data() + MAGIC_SIZE + 4 + (size_t) i * ENTRY_SIZE;
+      frame f{readUint64(entry), position, readUint64(entry + 8), 0, readUint32(entry + 16)};
+
+      // frames follow each other from the beginning of the file, the payload of each frame ends at the next one
+      uint64_t minimal = loaded.empty() ? 0 : loaded.back().offset + HEADER_SIZE;
+      if ((loaded.empty() ? f.offset != 0 : f.offset < minimal) || f.offset + HEADER_SIZE > offset
+          || (i == 0 && f.history > 0))
+        return false;
+
+      if (!loaded.empty())
+        loaded.back().payloadSize = f.offset - minimal;
+
+      loaded.push_back(f);
+      position += f.size;
+    }
+
+    if (!loaded.empty())
+      loaded.back().payloadSize = offset - loaded.back().offset - HEADER_SIZE;
+
+    _frames = loaded;
+    _end = offset;
+
+    return true;
+  }
+
+  /**
+   * Finds the frames by their headers from the beginning of the file, drops the incomplete frame or index
+   * after them
+   * @param fileSize size of the file
+   */
+  void scan(uint64_t fileSize) {
+    uint8_t header[HEADER_SIZE];
+    uint64_t offset = 0, position = 0;
+
+    while (fileSize - offset >= HEADER_SIZE && readAt(offset, header, HEADER_SIZE)
+        && memcmp(header, FRAME_MAGIC, MAGIC_SIZE) == 0) {
+      uint64_t size = readUint64(header + MAGIC_SIZE + 4);
+      uint64_t payloadSize = readUint64(header + MAGIC_SIZE + 12);
+
+      if (payloadSize > fileSize - offset - HEADER_SIZE)
+        break;
+
+      _frames.push_back({offset, position, size, payloadSize, readUint32(header + MAGIC_SIZE)});
+      offset += HEADER_SIZE + payloadSize;
+      position += size;
+    }
+
+    // only the incomplete frame or index written by the interrupted append may follow the frames
+    uint8_t magic[MAGIC_SIZE];
+    bool incomplete = !readAt(offset, magic, MAGIC_SIZE) || memcmp(magic, FRAME_MAGIC, MAGIC_SIZE) == 0
+        || memcmp(magic, INDEX_MAGIC, MAGIC_SIZE) == 0;
+
+    if ((_frames.empty() || !incomplete) && offset < fileSize)
+      error("Not a frame archive: " + _fileName + ".");
+
+    if (!_frames.empty() && _frames[0].history > 0)
+      error("Invalid frame archive: " + _fileName + ".");
+
+    _end = offset;
+  }
+
+  /**
+   * Writes the index after the frames and cuts the file after it
+   */
+  void writeIndex() {
+    vector<uint8_t> index(INDEX_SIZE + _frames.size() * ENTRY_SIZE);
+
+    memcpy(index.data(), INDEX_MAGIC, MAGIC_SIZE);
+    writeUint32(index.data() + MAGIC_SIZE, _frames.size());
+
+    for (size_t i = 0; i < _frames.size(); i++) {
+      uint8_t *entry = index.data() + MAGIC_SIZE + 4 + i * ENTRY_SIZE;
+      writeUint64(entry, _frames[i].offset);
+      writeUint64(entry + 8, _frames[i].size);
+      writeUint32(entry + 16, _frames[i].history);
+    }
+
+    writeUint64(index.data() + index.size() - 8 - MAGIC_SIZE, _end);
+    memcpy(index.data() + index.size() - MAGIC_SIZE, INDEX_MAGIC, MAGIC_SIZE);
+
+    _file.seekp(_end);
+    _file.write((const char *) index.data(), index.size());
+    _file.flush();
+
+    if (!_file)
+      error("Cannot write " + _fileName + ".");
+
+    // the tail of the interrupted append may be longer than the new frame and index
+    uint64_t size = _end + index.size();
+
+    if (filesystem::file_size(_fileName) > size) {
+      _file.close();
+      filesystem::resize_file(_fileName, size);
+      open();
+    }
+  }
+
+  /**
+   * Decompresses the frame and checks it
+   * @param index index of the frame
+   * @param previous contents of the previous frame, used if the frame is primed
+   * @param out contents of the frame
+   */
+  void decompressFrame(size_t index, const vector<uint8_t> &previous, vector<uint8_t> &out) {
+    const frame &f = _frames[index];
+    vector<uint8_t> payload(HEADER_SIZE + f.payloadSize);
+
+    if (!readAt(f.offset, payload.data(), payload.size()) || memcmp(payload.data(), FRAME_MAGIC, MAGIC_SIZE) != 0)
+      error("Damaged frame " + to_string(index) + ".");
+
+    if (f.history > previous.size())
+      error("Invalid history of frame " + to_string(index) + ".");
+
+    {
+      obytebuf bout(out);
+      if (f.history > 0)
+        bout.write(previous.data() + previous.size() - f.history, f.history);
+
+      _decoder.decompress(span<const uint8_t>(payload).subspan(HEADER_SIZE), f.history, bout);
+    }
+
+    out.erase(out.begin(), out.begin() + f.history);
+
+    if (out.size() != f.size || xxhash64::hash(out) != readUint64(payload.data() + MAGIC_SIZE + 20))
+      error("Checksum mismatch in frame " + to_string(index) + ".");
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_FRAMES_HPP_
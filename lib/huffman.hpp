@@ -7,228 +7,630 @@
 
 #include "archiver.hpp"
 
+/**
+ * Class for Huffman compression. Stream: header with the frequency table, then the codes of all bytes
+ * and PSEUDO_EOF. The interleaved format splits the bytes to STREAMS equal parts coded to separate
+ * sub-streams, the header is followed by the sizes of all sub-streams but the last one (4 bytes each),
+ * so the decoder advances all sub-streams in one loop and their dependency chains overlap
+ */
 class huffman : public archiver {
  public:
-  void compress(const string &inFileName, const string &outFileName) override {
-    archiver::compress(inFileName, outFileName);
+  /**
+   * Count of bits decoded by one lookup of the decoding table
+   */
+  static constexpr int TABLE_BITS = 11;
+
+  /**
+   * Count of sub-streams of the interleaved format
+   */
+  static constexpr int STREAMS = 4;
+
+  /**
+   * Reusable working memory for compression and decompression, after the first call
+   * compression and decompression do not allocate
+   */
+  struct context {
+    /**
+     * Frequency table, PSEUDO_EOF included
+     */
+    int freq[MAX_CHAR + 1];
+
+    /**
+     * Pool of nodes for building the tree, never reallocated so pointers to nodes stay valid
+     */
+    vector<Node> nodes;
+
+    /**
+     * Heap used for building the tree
+     */
+    vector<Node *> heap;
+
+    /**
+     * The tree packed for coding
+     */
+    FlatTree tree;
+
+    /**
+     * Codes of characters, the first bit of the code is its least significant one
+     */
+    uint64_t codes[MAX_CHAR + 1];
+
+    /**
+     * Lengths of codes
+     */
+    int lengths[MAX_CHAR + 1];
+
+    /**
+     * Decoding table indexed by the next TABLE_BITS bits: character | (code's length << 16),
+     * zero for codes longer than TABLE_BITS
+     */
+    vector<uint32_t> table;
+
+    /**
+     * Entries of the nodes reached by the first TABLE_BITS bits of codes longer than TABLE_BITS
+     */
+    vector<uint16_t> longNodes;
+
+    context() {
+      nodes.reserve(2 * (MAX_CHAR + 1));
+      heap.reserve(MAX_CHAR + 1);
+      table.resize(1 << TABLE_BITS);
+      longNodes.resize(1 << TABLE_BITS);
+    }
+  };
+
+  /**
+   * Default constructor
+   * @param interleaved if true, the interleaved format with STREAMS sub-streams is used
+   */
+  explicit huffman(bool interleaved = false) {
+    _interleaved = interleaved;
   }
 
-  void decompress(const string &inFileName, const string &outFileName) override {
-    archiver::decompress(inFileName, outFileName);
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    // header is at most 12 bytes per symbol, the average code length is less than entropy + 1 <= 9.01 bits,
+    // sub-streams add their sizes and padding
+    return 16 + MAX_CHAR * 12 + size + size / 8 + size / 64 + 5 * STREAMS;
   }
 
-  void compress(istream &in, ostream &out) override {
-    vector<uint8_t> contents = getContents(in);
-    map<ext_char, int> freq = getFrequencyTable(contents);
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    return compress(_ctx, in, out);
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    decompress(_ctx, in, out);
+  }
+
+  /**
+   * Compress buffer using given context
+   * @param ctx context
+   * @param in buffer to compress
+   * @param out buffer for compressed data
+   * @return count of compressed bytes
+   */
+  size_t compress(context &ctx, span<const uint8_t> in, span<uint8_t> out) {
+    getFrequencyTable(ctx, in);
 
-    writeHeader(out, freq);
-    Node *tree = buildEncodingTree(freq);
+    obitbuf bout(out);
+    writeHeader(bout, ctx);
+    buildEncodingTree(ctx);
 
-    encode(contents, tree, out);
-    freeNodeTree(tree);
+    if (_interleaved)
+      return encodeInterleaved(in, ctx, out, bout.flush());
+
+    encode(in, ctx, bout);
+
+    return bout.flush();
   }
 
-  void decompress(istream &in, ostream &out) override {
-    map<ext_char, int> freq = readHeader(in);
+  /**
+   * Decompress buffer using given context
+   * @param ctx context
+   * @param in buffer to decompress
+   * @param out output for decompressed data
+   */
+  void decompress(context &ctx, span<const uint8_t> in, obytebuf &out) {
+    readHeader(ctx, in);
+
+    buildEncodingTree(ctx);
+
+    // the tree is full, so only the single leaf of the empty contents has no children
+    if (FlatTree::isLeaf(ctx.tree.root))
+      return;
 
-    Node *tree = buildEncodingTree(freq);
+    makeDecodingTable(ctx, ctx.tree.root, 0, 0);
 
-    decode(in, tree, out);
-    freeNodeTree(tree);
+    if (_interleaved)
+      decodeInterleaved(in, ctx, out);
+    else
+      decode(in, ctx, out);
   }
 
- private:
   /**
-   * Gets and returns frequency table from contents
+   * Counts frequency table of contents
+   * @param ctx context
    * @param contents contents
-   * @return frequency table
    */
-  map<ext_char, int> getFrequencyTable(const vector<uint8_t> &contents) {
-    map<ext_char, int> result;
+  void getFrequencyTable(context &ctx, span<const uint8_t> contents) {
+    fill(begin(ctx.freq), end(ctx.freq), 0);
 
     for (const auto &ch: contents)
-      result[ch]++;
-
-    result[PSEUDO_EOF] = 1;
+      ctx.freq[ch]++;
 
-    return result;
+    ctx.freq[PSEUDO_EOF] = 1;
   }
 
   /**
-   * Builds tree from frequency table
-   * @param frequencies frequency table
-   * @return tree
+   * Builds tree from frequency table and packs it to the context's flat tree
+   * @param ctx context
    */
-  Node *buildEncodingTree(const map<ext_char, int> &frequencies) {
-    priority_queue<Node *, vector<Node *>, compare> pq;
+  void buildEncodingTree(context &ctx) {
+    ctx.nodes.clear();
+    ctx.heap.clear();
+
+    for (ext_char ch = 0; ch <= PSEUDO_EOF; ch++) {
+      if (ctx.freq[ch] != 0) {
+        ctx.nodes.emplace_back(ch, ctx.freq[ch]);
+        ctx.heap.push_back(&ctx.nodes.back());
+        push_heap(ctx.heap.begin(), ctx.heap.end(), compare());
+      }
+    }
 
-    for (const auto &freq : frequencies)
-      pq.push(new Node(freq.first, freq.second));
+    makeNodeTree(ctx);
 
-    makeNodeTree(pq);
+    ctx.tree.build(ctx.heap.front());
+  }
 
-    Node *lastNode = pq.top();
-    pq.pop();
+ private:
+  /**
+   * Default context
+   */
+  context _ctx;
 
-    return lastNode;
-  }
+  /**
+   * Is the interleaved format used
+   */
+  bool _interleaved;
 
   /**
    * Makes node tree
-   * @param pq queue with nodes
+   * @param ctx context with heap of nodes
    */
-  void makeNodeTree(priority_queue<Node *, vector<Node *>, compare> &pq) {
-    while (pq.size() > 1) {
+  void makeNodeTree(context &ctx) {
+    vector<Node *> &pq = ctx.heap;
 
-      Node *right = pq.top();
-      pq.pop();
+    while (pq.size() > 1) {
+      pop_heap(pq.begin(), pq.end(), compare());
+      Node *right = pq.back();
+      pq.pop_back();
 
-      Node *left = pq.top();
-      pq.pop();
+      pop_heap(pq.begin(), pq.end(), compare());
+      Node *left = pq.back();
+      pq.pop_back();
 
-      Node *top = new Node(NOT_A_CHAR, right->freq + left->freq);
+      ctx.nodes.emplace_back(NOT_A_CHAR, right->freq + left->freq);
+      Node *top = &ctx.nodes.back();
       top->one = right;
       top->zero = left;
 
-      pq.push(top);
+      pq.push_back(top);
+      push_heap(pq.begin(), pq.end(), compare());
     }
   }
 
   /**
-   * Frees node tree
-   * @param root root of the tree
+   * Write header with frequency table to bitbuf
+   * @param bout bitbuf
+   * @param ctx context with frequency table
    */
-  void freeNodeTree(Node *root) {
-    if (root->one)
-      freeNodeTree(root->one);
+  void writeHeader(obitbuf &bout, const context &ctx) {
+    if (ctx.freq[PSEUDO_EOF] <= 0) {
+      error("No PSEUDO_EOF defined.");
+    }
+
+    writeNumber(bout, count_if(begin(ctx.freq), end(ctx.freq) - 1, [](int freq) { return freq != 0; }));
 
-    if (root->zero)
-      freeNodeTree(root->zero);
+    bout.writeData(' ', BYTE_SIZE);
 
-    delete root;
+    for (ext_char ch = 0; ch < MAX_CHAR; ch++) {
+      if (ctx.freq[ch] == 0) continue;
+
+      bout.writeData(ch, BYTE_SIZE);
+      writeNumber(bout, ctx.freq[ch]);
+      bout.writeData(' ', BYTE_SIZE);
+    }
   }
 
   /**
-   * Write header with frequency table to stream
-   * @param out stream
-   * @param frequencies frequency table
+   * Writes decimal number to bitbuf
+   * @param bout bitbuf
+   * @param number number
    */
-  void writeHeader(ostream &out, map<ext_char, int> &frequencies) {
-    if (frequencies.count(PSEUDO_EOF) <= 0) {
-      error("No PSEUDO_EOF defined.");
+  void writeNumber(obitbuf &bout, uint64_t number) {
+    char digits[20];
+    int count = 0;
+
+    do {
+      digits[count++] = (char) ('0' + number % 10);
+      number /= 10;
+    } while (number);
+
+    while (count)
+      bout.writeData(digits[--count], BYTE_SIZE);
+  }
+
+  /**
+   * Read frequency table from buffer and skips it
+   * @param ctx context for frequency table
+   * @param in buffer
+   */
+  void readHeader(context &ctx, span<const uint8_t> &in) {
+    fill(begin(ctx.freq), end(ctx.freq), 0);
+    size_t pos = 0;
+
+    int numValues = readNumber(in, pos);
+    readSeparator(in, pos);
+
+    if (numValues > MAX_CHAR)
+      error("Invalid huffman header.");
+
+    // frequencies are summed by the tree, so their sum has to fit to int
+    int64_t total = 1;
+
+    for (int i = 0; i < numValues; i++) {
+      if (pos >= in.size())
+        error("Unexpected end of stream.");
+
+      ext_char ch = in[pos++];
+
+      int frequency = readNumber(in, pos);
+      readSeparator(in, pos);
+
+      total += frequency - ctx.freq[ch];
+      if (total > INT32_MAX)
+        error("Invalid huffman header.");
+
+      ctx.freq[ch] = frequency;
+    }
+
+    ctx.freq[PSEUDO_EOF] = 1;
+
+    in = in.subspan(pos);
+  }
+
+  /**
+   * Skips the separator after the number
+   * @param in buffer
+   * @param pos position of the separator, moved past it
+   */
+  void readSeparator(span<const uint8_t> in, size_t &pos) {
+    if (pos >= in.size() || in[pos] != ' ')
+      error("Invalid huffman header.");
+
+    pos++;
+  }
+
+  /**
+   * Reads decimal number from buffer
+   * @param in buffer
+   * @param pos position of the number, moved past it
+   * @return number
+   */
+  int readNumber(span<const uint8_t> in, size_t &pos) {
+    int number = 0;
+
+    while (pos < in.size() && in[pos] >= '0' && in[pos] <= '9') {
+      if (number > (INT32_MAX - 9) / 10)
+        error("Invalid huffman header.");
+
+      number = number * 10 + (in[pos++] - '0');
     }
 
-    out << frequencies.size() - 1;
+    return number;
+  }
+
+  /**
+   * Encodes contents to bitbuf
+   * @param contents contents
+   * @param ctx context with the tree and for codes
+   * @param bout bitbuf
+   */
+  void encode(span<const uint8_t> contents, context &ctx, obitbuf &bout) {
+    makeEncodingMap(ctx, ctx.tree.root, 0, 0);
+
+    for (const uint8_t &ch: contents)
+      bout.writeData(ctx.codes[ch], ctx.lengths[ch]);
+
+    bout.writeData(ctx.codes[PSEUDO_EOF], ctx.lengths[PSEUDO_EOF]);
+  }
+
+  /**
+   * Encodes contents to equal parts coded to separate sub-streams after the sizes of sub-streams
+   * @param contents contents
+   * @param ctx context with the tree and for codes
+   * @param out output buffer
+   * @param size count of already written bytes
+   * @return count of written bytes
+   */
+  size_t encodeInterleaved(span<const uint8_t> contents, context &ctx, span<uint8_t> out, size_t size) {
+    const size_t JUMP_SIZE = 4 * (STREAMS - 1);
+
+    makeEncodingMap(ctx, ctx.tree.root, 0, 0);
+
+    if (out.size() - size < JUMP_SIZE)
+      error("Output buffer is too small.");
+
+    size_t jump = size;
+    size += JUMP_SIZE;
+
+    size_t part = (contents.size() + STREAMS - 1) / STREAMS;
 
-    out << ' ';
+    for (int k = 0; k < STREAMS; k++) {
+      size_t begin = min(k * part, contents.size());
+      obitbuf sout(out.subspan(size));
 
-    for (const auto &val: frequencies) {
-      ext_char ch = val.first;
+      for (const uint8_t &ch: contents.subspan(begin, min(part, contents.size() - begin)))
+        sout.writeData(ctx.codes[ch], ctx.lengths[ch]);
 
-      if (ch == PSEUDO_EOF) continue;
+      size_t streamSize = sout.flush();
 
-      uint8_t res = ch;
+      if (k < STREAMS - 1)
+        writeUint32(out.data() + jump + 4 * k, streamSize);
 
-      out << res << frequencies[ch] << ' ';
+      size += streamSize;
     }
+
+    return size;
   }
 
   /**
-   * Read frequency table from stream
-   * @param in stream
-   * @return frequency table
+   * Fills the decoding table
+   * @param ctx context with the tree and for the table
+   * @param node entry of the current node
+   * @param code current code
+   * @param length current code's length
    */
-  map<ext_char, int> readHeader(istream &in) {
-    map<ext_char, int> result;
+  void makeDecodingTable(context &ctx, uint16_t node, uint32_t code, int length) {
+    if (FlatTree::isLeaf(node)) {
+      for (uint32_t i = code; i < (1u << TABLE_BITS); i += 1u << length)
+        ctx.table[i] = FlatTree::character(node) | (length << 16);
+      return;
+    }
 
-    int numValues;
-    in >> numValues;
+    if (length == TABLE_BITS) {
+      ctx.table[code] = 0;
+      ctx.longNodes[code] = node;
+      return;
+    }
 
-    in.get();
+    makeDecodingTable(ctx, ctx.tree.child(node, 0), code, length + 1);
+    makeDecodingTable(ctx, ctx.tree.child(node, 1), code | (1u << length), length + 1);
+  }
 
-    for (int i = 0; i < numValues; i++) {
-      char c = in.get();
-      ext_char ch = (uint8_t) c;
+  /**
+   * Decodes one character by the decoding table, bits past the end are read as zeros
+   * @param bin bitbuf
+   * @param ctx context with the decoding table
+   * @return the character
+   */
+  ext_char decodeCharacter(ibitbuf &bin, const context &ctx) {
+    uint64_t bits = bin.peekData(TABLE_BITS);
+    uint32_t entry = ctx.table[bits];
 
-      int frequency;
-      in >> frequency;
+    if (entry) {
+      bin.skip(entry >> 16);
+      return entry & 0xFFFF;
+    }
 
-      in.get();
+    return decodeLongCharacter(bin, ctx, bits);
+  }
 
-      result[ch] = frequency;
+  /**
+   * Decodes one character by the decoding table, at least TABLE_BITS bits have to be loaded
+   * @param bin bitbuf
+   * @param ctx context with the decoding table
+   * @return the character
+   */
+  ext_char decodeLoaded(ibitbuf &bin, const context &ctx) {
+    uint64_t bits = bin.peekLoaded(TABLE_BITS);
+    uint32_t entry = ctx.table[bits];
+
+    if (entry) {
+      bin.skip(entry >> 16);
+      return entry & 0xFFFF;
     }
 
-    result[PSEUDO_EOF] = 1;
-    return result;
+    return decodeLongCharacter(bin, ctx, bits);
   }
 
   /**
-   * Encodes contents to output stream
-   * @param contents contents
-   * @param tree node tree
-   * @param out output stream
+   * Decodes the rest of the character with code longer than TABLE_BITS by the tree, then loads
+   * as many bits as possible
+   * @param bin bitbuf
+   * @param ctx context with the decoding table
+   * @param bits the first TABLE_BITS bits of the code
+   * @return the character
    */
-  void encode(vector<uint8_t> &contents, Node *tree, ostream &out) {
-    unordered_map<ext_char, string> encodingMap;
-      string code;
-    makeEncodingMap(encodingMap, tree, code);
+  ext_char decodeLongCharacter(ibitbuf &bin, const context &ctx, uint64_t bits) {
+    uint16_t curr = ctx.longNodes[bits];
+    bin.skip(TABLE_BITS);
 
-    obitbuf bout;
+    while (!FlatTree::isLeaf(curr)) {
+      int bit = bin.readBit();
 
-    for (const uint8_t &ch: contents)
-      bout.addBinaryString(encodingMap[ch]);
+      if (bit < 0)
+        error("Unexpected end of stream.");
+
+      curr = ctx.tree.child(curr, bit);
+    }
 
-    bout.addBinaryString(encodingMap[PSEUDO_EOF]);
-    bout.writeToStream(out);
+    bin.refill();
+
+    return FlatTree::character(curr);
   }
 
   /**
- * Decodes input stream and writes results to output stream
- * @param in input stream
- * @param tree node tree
- * @param out output stream
- */
-  void decode(istream &in, Node *tree, ostream &out) {
-      ibitbuf bin(in);
+   * Decodes input buffer and writes results to output
+   * @param in input buffer
+   * @param ctx context with the decoding table
+   * @param out output
+   */
+  void decode(span<const uint8_t> in, const context &ctx, obytebuf &out) {
+    ibitbuf bin(in);
+
+    while (true) {
+      ext_char ch = decodeCharacter(bin, ctx);
+
+      if (bin.overrun())
+        error("Unexpected end of stream.");
+
+      if (ch == PSEUDO_EOF)
+        break;
+
+      out.put((uint8_t) ch);
+    }
+  }
+
+  /**
+   * Decodes sub-streams of the interleaved format and writes results to output
+   * @param in input buffer
+   * @param ctx context with frequency table and the decoding table
+   * @param out output
+   */
+  void decodeInterleaved(span<const uint8_t> in, const context &ctx, obytebuf &out) {
+    const size_t JUMP_SIZE = 4 * (STREAMS - 1);
+
+    uint64_t size = 0;
+    for (ext_char ch = 0; ch < MAX_CHAR; ch++)
+      size += ctx.freq[ch];
+
+    // every character takes at least one bit
+    if (in.size() < JUMP_SIZE || size > (in.size() - JUMP_SIZE) * BYTE_SIZE)
+      error("Unexpected end of stream.");
+
+    span<const uint8_t> streams[STREAMS];
+    size_t offset = JUMP_SIZE;
+
+    for (int k = 0; k < STREAMS - 1; k++) {
+      size_t streamSize = readUint32(in.data() + 4 * k);
+
+      if (streamSize > in.size() - offset)
+        error("Unexpected end of stream.");
 
-      int bit;
-      Node *root = tree;
-      Node *curr = root;
+      streams[k] = in.subspan(offset, streamSize);
+      offset += streamSize;
+    }
+
+    streams[STREAMS - 1] = in.subspan(offset);
+
+    size_t part = (size + STREAMS - 1) / STREAMS;
+    size_t counts[STREAMS];
+    uint8_t *dst[STREAMS];
+    uint8_t *result = out.extend(size);
+
+    for (int k = 0; k < STREAMS; k++) {
+      size_t begin = min(k * part, size);
+      counts[k] = min(part, size - begin);
+      dst[k] = result + begin;
+    }
 
-      while (true) {
-          bit = bin.readBit();
+    ibitbuf b0(streams[0]), b1(streams[1]), b2(streams[2]), b3(streams[3]);
 
-          if (bit == 1)
-              curr = curr->one;
-          else if (bit == 0)
-              curr = curr->zero;
+    // PSEUDO_EOF is not a valid character here, it is checked once after the loops
+    ext_char seen = 0;
 
-          if (curr->character == PSEUDO_EOF)
-              break;
+    // the last part is the shortest one, while every sub-stream has at least 8 bytes more
+    // one refill loads 56 bits, enough for 4 codes of the table
+    size_t i = 0;
+    for (; i + 4 <= counts[STREAMS - 1] && b0.hasMargin() && b1.hasMargin() && b2.hasMargin() && b3.hasMargin();) {
+      b0.refill();
+      b1.refill();
+      b2.refill();
+      b3.refill();
 
-          if (curr->character != NOT_A_CHAR) {
-              out << (char) curr->character;
-              curr = root;
-          }
+      for (size_t end = i + 4; i < end; i++) {
+        ext_char c0 = decodeLoaded(b0, ctx);
+        ext_char c1 = decodeLoaded(b1, ctx);
+        ext_char c2 = decodeLoaded(b2, ctx);
+        ext_char c3 = decodeLoaded(b3, ctx);
+
+        dst[0][i] = (uint8_t) c0;
+        dst[1][i] = (uint8_t) c1;
+        dst[2][i] = (uint8_t) c2;
+        dst[3][i] = (uint8_t) c3;
+
+        seen |= c0 | c1 | c2 | c3;
       }
+    }
+
+    for (; i < counts[STREAMS - 1]; i++) {
+      ext_char c0 = decodeCharacter(b0, ctx);
+      ext_char c1 = decodeCharacter(b1, ctx);
+      ext_char c2 = decodeCharacter(b2, ctx);
+      ext_char c3 = decodeCharacter(b3, ctx);
+
+      dst[0][i] = (uint8_t) c0;
+      dst[1][i] = (uint8_t) c1;
+      dst[2][i] = (uint8_t) c2;
+      dst[3][i] = (uint8_t) c3;
+
+      seen |= c0 | c1 | c2 | c3;
+    }
+
+    seen |= decodeTail(b0, ctx, dst[0], i, counts[0]);
+    seen |= decodeTail(b1, ctx, dst[1], i, counts[1]);
+    seen |= decodeTail(b2, ctx, dst[2], i, counts[2]);
+
+    if (seen & MAX_CHAR)
+      error("Invalid huffman stream.");
+
+    // every sub-stream ends by its padding
+    for (const ibitbuf *bin: {&b0, &b1, &b2, &b3})
+      if (bin->overrun() || bin->remaining() >= BYTE_SIZE)
+        error("Invalid huffman stream.");
   }
 
-    /**
-     * Makes encoding map
-     * @param encodingMap encoding map
-     * @param node current node
-     * @param code current code
-     */
-    void makeEncodingMap(unordered_map<ext_char, string> &encodingMap, Node *node, const string &code) {
-        if (node->one)
-            makeEncodingMap(encodingMap, node->one, code + "1");
+  /**
+   * Decodes the rest of the sub-stream
+   * @param bin bitbuf
+   * @param ctx context with the decoding table
+   * @param dst output of the sub-stream
+   * @param begin index of the first character
+   * @param end index after the last character
+   * @return bitwise or of the decoded characters
+   */
+  ext_char decodeTail(ibitbuf &bin, const context &ctx, uint8_t *dst, size_t begin, size_t end) {
+    ext_char seen = 0;
+
+    for (size_t i = begin; i < end; i++) {
+      ext_char ch = decodeCharacter(bin, ctx);
+      dst[i] = (uint8_t) ch;
+      seen |= ch;
+    }
 
-        if (node->zero)
-            makeEncodingMap(encodingMap, node->zero, code + "0");
+    return seen;
+  }
 
-        if (node->character != NOT_A_CHAR)
-            encodingMap[node->character] = code;
+  /**
+   * Makes encoding map, the first bit of the code is its least significant one
+   * @param ctx context with the tree and for codes
+   * @param node entry of the current node
+   * @param code current code
+   * @param length current code's length
+   */
+  void makeEncodingMap(context &ctx, uint16_t node, uint64_t code, int length) {
+    if (FlatTree::isLeaf(node)) {
+      ctx.codes[FlatTree::character(node)] = code;
+      ctx.lengths[FlatTree::character(node)] = length;
+      return;
     }
+
+    makeEncodingMap(ctx, ctx.tree.child(node, 1), code | ((uint64_t) 1 << length), length + 1);
+    makeEncodingMap(ctx, ctx.tree.child(node, 0), code, length + 1);
+  }
 };
 
 #endif //HW_ARCHIVER_LIB_HUFFMAN_HPP_
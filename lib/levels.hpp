@@ -0,0 +1,423 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_LEVELS_HPP_
+#define HW_ARCHIVER_LIB_LEVELS_HPP_
+
+#include "blockwise.hpp"
+#include "bwt.hpp"
+#include "ctxhuffman.hpp"
+#include "filter.hpp"
+#include "huffman.hpp"
+#include "lz77long.hpp"
+#include "pipeline.hpp"
+#include <memory>
+
+/**
+ * Archiver which passes the stream of the first archiver to the second one, so the second one is
+ * the entropy stage of the first one
+ */
+class chain : public archiver {
+ public:
+  /**
+   * Default constructor
+   * @param first the first archiver, owned by chain
+   * @param second the second archiver, owned by chain
+   */
+  chain(archiver *first, archiver *second) : _first(first), _second(second) {}
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    return _second->compressBound(_first->compressBound(size));
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    _buffer.resize(_first->compressBound(in.size()));
+    size_t size = _first->compress(in, _buffer);
+
+    return _second->compress(span<const uint8_t>(_buffer.data(), size), out);
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    _second->decompress(in, _buffer);
+    _first->decompress(_buffer, out);
+  }
+
+ private:
+  unique_ptr<archiver> _first, _second;
+
+  /**
+   * Stream of the first archiver
+   */
+  vector<uint8_t> _buffer;
+};
+
+/**
+ * Archiver with compression levels from 1 (the fastest) to MAX_LEVEL (the smallest). Every level is a preset
+ * of the codec, its window, the depth of the match finder, the parse strategy, the entropy stage and
+ * the filter, all levels are blockwise, so incompressible blocks are stored. Measured on DATA/original
+ * (20.9 MB, one thread, the best of 3 runs):
+ *
+ * level  preset                                        ratio  compress MB/s  decompress MB/s
+ *   1    huffman                                       1.168          229              436
+ *   2    lz77 64K, depth 1, greedy, filter             1.397           39              233
+ *   3    lz77 256K, depth 1, greedy, filter            1.403           33              218
+ *   4    lz77 256K, depth 2, greedy, filter            1.441           25              225
+ *   5    lz77 1M, depth 2, greedy, filter              1.482           19              213
+ *   6    lz77 1M, depth 4, greedy, filter              1.492           14              241
+ *   7    lz77 1M, depth 4, lazy, filter                1.496           15              218
+ *   8    lz77 1M, depth 8, lazy, filter                1.505           11              207
+ *   9    lz77 4M, depth 8, lazy, filter                1.515          6.6              302
+ *  10    lz77 4M, depth 16, lazy, ctxhuffman, filter   1.542          5.1              172
+ *  11    lz77 16M, depth 32, lazy, ctxhuffman, filter  1.546          3.5              161
+ *  12    lz77 64M, depth 64, lazy, ctxhuffman, filter  1.551          3.6              164
+ *  13    lz77 64M, depth 256, lazy, ctxhuffman, filter 1.557          2.6              175
+ *  14    bwt 1M                                        1.618          8.5               15
+ *  15    bwt 1M, filter                                1.641          7.4               11
+ *  16    bwt 2M, filter                                1.662          4.9              8.9
+ *  17    bwt 4M, filter                                1.662          4.3              9.3
+ *  18    bwt 8M, filter                                1.662          4.4              9.3
+ *  19    bwt 16M, filter                               1.662          4.3              9.1
+ *
+ * BWT levels compress faster than the deepest lz77 ones but decompress much slower. The files of the corpus
+ * are about 2 MB, so blocks and windows above it do not change the ratio there, they do on larger inputs.
+ * Streams and files are compressed by the pipeline of `threads` workers with their own archivers, buffers
+ * are compressed by one archiver whose lz77 parse uses `threads` threads. The memory budget bounds the estimate
+ * of the compressor's memory: the count of threads is reduced first, then the window and the blocks are halved
+ * down to MIN_WINDOW, so the level keeps its depth, parse and stages. Streams carry the block sizes, so
+ * the decompressor does not depend on the budget.
+ * Stream: level (1 byte), the blockwise stream of the level's archiver
+ */
+class levels : public archiver {
+ public:
+  /**
+   * Codecs
+   */
+  enum codecs { HUFFMAN = 0, LZ77 = 1, BWT = 2 };
+
+  /**
+   * Entropy stages applied to the codec's stream
+   */
+  enum stages { RAW = 0, CONTEXT = 1 };
+
+  /**
+   * Settings of the level
+   */
+  struct preset {
+    codecs codec;
+
+    /**
+     * Window of lz77, size of blocks of BWT
+     */
+    uint64_t window;
+
+    /**
+     * Maximal count of candidates checked by the match finder for every match
+     */
+    int depth;
+
+    lz77long::parses parse;
+
+    stages entropy;
+
+    /**
+     * Is the input filtered by the content
+     */
+    bool filtered;
+  };
+
+  static constexpr int MIN_LEVEL = 1;
+  static constexpr int MAX_LEVEL = 19;
+  static constexpr int DEFAULT_LEVEL = 6;
+
+  /**
+   * Size of the header
+   */
+  static constexpr unsigned int HEADER_SIZE = 1;
+
+  /**
+   * Maximal length of lz77 matches
+   */
+  static constexpr unsigned int LOOKAHEAD = 1 << 16;
+
+  /**
+   * Minimal size of blocks, larger windows take blocks of their size
+   */
+  static constexpr size_t MIN_BLOCK_SIZE = 1 << 20;
+
+  /**
+   * Minimal window and size of blocks taken by the memory budget
+   */
+  static constexpr size_t MIN_WINDOW = 64 << 10;
+
+  /**
+   * Count of blocks queued for every thread of the pipeline
+   */
+  static constexpr unsigned int PIPELINE_DEPTH = 2;
+
+  /**
+   * Presets of levels from MIN_LEVEL
+   */
+  static constexpr preset PRESETS[MAX_LEVEL] = {
+      {HUFFMAN, 0, 0, lz77long::GREEDY, RAW, false},
+      {LZ77, 64 << 10, 1, lz77long::GREEDY, RAW, true},
+      {LZ77, 256 << 10, 1, lz77long::GREEDY, RAW, true},
+      {LZ77, 256 << 10, 2, lz77long::GREEDY, RAW, true},
+      {LZ77, 1 << 20, 2, lz77long::GREEDY, RAW, true},
+      {LZ77, 1 << 20, 4, lz77long::GREEDY, RAW, true},
+      {LZ77, 1 << 20, 4, lz77long::LAZY, RAW, true},
+      {LZ77, 1 << 20, 8, lz77long::LAZY, RAW, true},
+      {LZ77, 4 << 20, 8, lz77long::LAZY, RAW, true},
+      {LZ77, 4 << 20, 16, lz77long::LAZY, CONTEXT, true},
+      {LZ77, 16 << 20, 32, lz77long::LAZY, CONTEXT, true},
+      {LZ77, 64 << 20, 64, lz77long::LAZY, CONTEXT, true},
+      {LZ77, 64 << 20, 256, lz77long::LAZY, CONTEXT, true},
+      {BWT, 1 << 20, 0, lz77long::GREEDY, RAW, false},
+      {BWT, 1 << 20, 0, lz77long::GREEDY, RAW, true},
+      {BWT, 2 << 20, 0, lz77long::GREEDY, RAW, true},
+      {BWT, 4 << 20, 0, lz77long::GREEDY, RAW, true},
+      {BWT, 8 << 20, 0, lz77long::GREEDY, RAW, true},
+      {BWT, 16 << 20, 0, lz77long::GREEDY, RAW, true},
+  };
+
+  /**
+   * Default constructor
+   * @param level level from MIN_LEVEL to MAX_LEVEL
+   * @param threads count of threads
+   * @param budget maximal memory of compression in bytes, 0 for no limit
+   */
+  explicit levels(int level = DEFAULT_LEVEL, unsigned int threads = 1, size_t budget = 0) {
+    checkLevel(level);
+
+    _level = level;
+    _threads = max(threads, 1u);
+    _preset = getPreset(level);
+    _blockSize = getBlockSize(_preset);
+
+    if (budget != 0)
+      fit(budget);
+
+    _archiver.reset(create(_preset, _threads, _blockSize));
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    return HEADER_SIZE + _archiver->compressBound(size);
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    if (out.empty())
+      error("Output buffer is too small.");
+
+    out[0] = _level;
+
+    return HEADER_SIZE + _archiver->compress(in, out.subspan(HEADER_SIZE));
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    if (in.size() < HEADER_SIZE)
+      error("Unexpected end of stream.");
+
+    checkLevel(in[0]);
+
+    // streams of other levels are decompressed by their own archivers, which are kept for the next streams
+    if (in[0] != _level && in[0] != _decoderLevel) {
+      _decoder.reset(create(getPreset(in[0]), _threads));
+      _decoderLevel = in[0];
+    }
+
+    archiver &arch = in[0] == _level ? *_archiver : *_decoder;
+    arch.decompress(in.subspan(HEADER_SIZE), out);
+  }
+
+  void compress(istream &in, ostream &out) override {
+    out.put((char) _level);
+    pipeline([&]() { return create(_preset, 1, _blockSize); }, _threads, PIPELINE_DEPTH).compress(in, out);
+  }
+
+  void decompress(istream &in, ostream &out) override {
+    int level = in.get();
+
+    if (level == EOF)
+      error("Unexpected end of stream.");
+
+    const preset &p = getPreset(level);
+    pipeline([&]() { return create(p); }, _threads, PIPELINE_DEPTH).decompress(in, out);
+  }
+
+  /**
+   * Returns the estimate of the compressor's memory with the settings taken by the budget
+   * @return count of bytes
+   */
+  size_t getMemoryUsage() const {
+    return getMemoryUsage(_preset, _blockSize, _threads);
+  }
+
+  /**
+   * Returns count of threads taken by the budget
+   * @return count of threads
+   */
+  unsigned int getThreads() const {
+    return _threads;
+  }
+
+  /**
+   * Returns preset of the level
+   * @param level level from MIN_LEVEL to MAX_LEVEL
+   * @return the preset
+   */
+  static const preset &getPreset(int level) {
+    checkLevel(level);
+
+    return PRESETS[level - MIN_LEVEL];
+  }
+
+  /**
+   * Creates archiver of the preset
+   * @param p preset
+   * @param threads maximal count of threads parsing the input
+   * @param blockSize size of blocks, 0 for the preset's one
+   * @return the archiver
+   */
+  static blockwise *create(const preset &p, unsigned int threads = 1, size_t blockSize = 0) {
+    archiver *arch;
+
+    if (blockSize == 0)
+      blockSize = getBlockSize(p);
+
+    switch (p.codec) {
+      case HUFFMAN:
+        arch = new huffman(true);
+        break;
+      case LZ77:
+        arch = new lz77long(p.window, LOOKAHEAD, p.depth, threads, p.parse);
+        break;
+      case BWT:
+        arch = new bwt();
+        break;
+      default:
+        error("Invalid codec.");
+    }
+
+    if (p.entropy == CONTEXT)
+      arch = new chain(arch, new ctxhuffman());
+
+    if (p.filtered)
+      arch = new filter(arch);
+
+    return new blockwise(arch, blockSize);
+  }
+
+  /**
+   * Returns size of blocks of the preset
+   * @param p preset
+   * @return size of blocks
+   */
+  static size_t getBlockSize(const preset &p) {
+    size_t blockSize = max<size_t>(MIN_BLOCK_SIZE, p.window);
+
+    return p.codec == BWT ? min<size_t>(blockSize, bwt::MAX_SIZE) : blockSize;
+  }
+
+  /**
+   * Estimates the largest memory of compression, the sizes of the buffers and tables of the codecs are
+   * taken from their implementations
+   * @param p preset
+   * @param blockSize size of blocks
+   * @param threads count of threads
+   * @return count of bytes
+   */
+  static size_t getMemoryUsage(const preset &p, size_t blockSize, unsigned int threads) {
+    size_t bound = blockSize + blockSize / BYTE_SIZE;
+
+    // queued blocks and their streams
+    size_t usage = PIPELINE_DEPTH * (blockSize + bound);
+
+    switch (p.codec) {
+      case HUFFMAN:
+        break;
+      case LZ77: {
+        uint64_t shortWindow = (uint64_t) 1 << countBits(min(p.window, lz77long::SHORT_WINDOW) - 1);
+
+        usage += sizeof(int64_t) * (lz77context::HASH_SIZE + shortWindow);
+
+        if (p.window > lz77long::SHORT_WINDOW)
+          usage += (sizeof(uint64_t) + sizeof(int64_t)) << countBits((p.window - 1) >> ldmtable::SAMPLE_BITS);
+
+        // triplets of the segments parsed by the threads
+        usage += bound;
+        break;
+      }
+      case BWT:
+        // text and suffix array of int32_t, types, transform and symbols
+        usage += 2 * sizeof(int32_t) * blockSize + 4 * blockSize;
+        break;
+    }
+
+    // stream of the codec and the tables of ctxhuffman
+    if (p.entropy == CONTEXT)
+      usage += bound + sizeof(uint32_t) * MAX_CHAR * MAX_CHAR +
+          ctxhuffman::MAX_GROUPS * (sizeof(uint16_t) << ctxhuffman::MAX_LENGTH);
+
+    if (p.filtered)
+      usage += blockSize;
+
+    return usage * threads;
+  }
+
+ private:
+  int _level;
+
+  unsigned int _threads;
+
+  /**
+   * Preset and size of blocks taken by the budget
+   */
+  preset _preset;
+  size_t _blockSize;
+
+  /**
+   * Archiver of the level
+   */
+  unique_ptr<archiver> _archiver;
+
+  /**
+   * Archiver of the last decompressed stream of other level
+   */
+  unique_ptr<archiver> _decoder;
+
+  int _decoderLevel{0};
+
+  /**
+   * Checks the level
+   * @param level level
+   */
+  static void checkLevel(int level) {
+    if (level < MIN_LEVEL || level > MAX_LEVEL)
+      error("Invalid compression level.");
+  }
+
+  /**
+   * Reduces the count of threads, then halves the window and the blocks until the estimate fits the budget
+   * @param budget maximal memory in bytes
+   */
+  void fit(size_t budget) {
+    while (getMemoryUsage(_preset, _blockSize, _threads) > budget) {
+      if (_threads > 1) {
+        _threads--;
+      } else if (_blockSize > MIN_WINDOW) {
+        _blockSize /= 2;
+        _preset.window = min<uint64_t>(_preset.window, _blockSize);
+      } else {
+        error("Memory budget is too small.");
+      }
+    }
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_LEVELS_HPP_
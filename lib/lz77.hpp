@@ -8,68 +8,281 @@
 #include "types.h"
 #include "archiver.hpp"
 #include "bitbuf.hpp"
+#include "cpu.hpp"
 #include <string>
 #include <algorithm>
 #include <vector>
 
 using namespace std;
 
+/**
+ * Reusable working memory of the lz77 match finder, after the first call compression does not allocate
+ */
+struct lz77context {
+  /**
+   * Count of pairs of bytes
+   */
+  static constexpr unsigned int HASH_SIZE = 1 << (2 * BYTE_SIZE);
+
+  /**
+   * The last position of every pair of bytes
+   */
+  vector<int64_t> head;
+
+  /**
+   * The previous position with the same pair of bytes, indexed by position modulo window
+   */
+  vector<int64_t> prev;
+
+  /**
+   * The last position of every byte
+   */
+  int64_t last[MAX_CHAR];
+
+  /**
+   * Mask for indexing positions in the window
+   */
+  uint64_t mask{0};
+
+  /**
+   * Forgets all positions
+   * @param window window's size
+   */
+  void reset(unsigned int window) {
+    mask = lowMask(countBits(window - 1));
+
+    head.assign(HASH_SIZE, -1);
+    prev.resize(mask + 1);
+    fill(begin(last), end(last), -1);
+  }
+
+  /**
+   * Returns the key of the pair of bytes starting at the index
+   * @param i index
+   * @param contents contents
+   * @return the key
+   */
+  static unsigned int pairKey(int64_t i, span<const uint8_t> contents) {
+    return contents[i] | (contents[i + 1] << BYTE_SIZE);
+  }
+
+  /**
+   * Adds position to the match finder
+   * @param i index
+   * @param contents contents
+   */
+  void insert(int64_t i, span<const uint8_t> contents) {
+    if (i + 1 < (int64_t) contents.size()) {
+      unsigned int key = pairKey(i, contents);
+      prev[i & mask] = head[key];
+      head[key] = i;
+    }
+
+    last[contents[i]] = i;
+  }
+
+  /**
+   * Finds the longest match in the window for given index, the nearest one is taken among equal ones
+   * @param i index
+   * @param contents contents
+   * @param window window's size, at most the one given to reset
+   * @param lookahead maximal length of the match
+   * @param depth maximal count of candidates checked
+   * @return triplet with the match and its next byte
+   */
+  Triplet find(int64_t i, span<const uint8_t> contents, int64_t window, int64_t lookahead, int depth) const {
+    const int64_t start = i - window;
+
+    // the match is followed by its next byte, so it cannot reach the last byte
+    const int64_t lend = min<int64_t>(lookahead, (int64_t) contents.size() - 1 - i);
+
+    int64_t maxLen = 0, fndIndex = 1;
+
+    if (lend >= 2) {
+      for (int64_t cand = head[pairKey(i, contents)]; cand >= start && cand >= 0 && depth > 0;
+           cand = prev[cand & mask], depth--) {
+        if (contents[cand + maxLen] != contents[i + maxLen])
+          continue;
+
+        int64_t j = 2 + cpu::matchLength(&contents[cand + 2], &contents[i + 2], lend - 2);
+
+        if (j > maxLen) {
+          fndIndex = i - cand;
+          maxLen = j;
+
+          if (j == lend)
+            break;
+        }
+      }
+    }
+
+    if (maxLen == 0 && lend >= 1) {
+      int64_t cand = last[contents[i]];
+
+      if (cand >= start && cand >= 0) {
+        fndIndex = i - cand;
+        maxLen = 1;
+      }
+    }
+
+    return Triplet(fndIndex, maxLen, contents[i + maxLen]);
+  }
+};
+
+/**
+ * Compression and decompression loops of lz77, S and T are the window's and the lookahead's sizes,
+ * zero values mean that sizes are given at runtime
+ * @tparam S window's size
+ * @tparam T lookahead's size
+ */
 template<int S, int T>
-struct lz77 : archiver {
+class lz77kernel {
  public:
-  void compress(const string &inFileName, const string &outFileName) override {
-    archiver::compress(inFileName, outFileName);
+  /**
+   * Default constructor
+   * @param window window's size, used only if S is zero
+   * @param lookahead lookahead's size, used only if T is zero
+   */
+  explicit lz77kernel(unsigned int window = S, unsigned int lookahead = T) {
+    _window = window;
+    _lookahead = lookahead;
+    _j = countBits(window - 1);
+    _k = countBits(lookahead);
   }
 
-  void decompress(const string &inFileName, const string &outFileName) override {
-    archiver::decompress(inFileName, outFileName);
+  /**
+   * Counts and returns the maximal compressed size of the data with given size
+   * @param size size of the data
+   * @return the maximal compressed size
+   */
+  size_t compressBound(size_t size) const {
+    // every triplet encodes at least one byte, plus the last flag bit
+    return (size * (J() + K() + C) + 1 + BYTE_SIZE - 1) / BYTE_SIZE;
   }
 
-  void compress(istream &in, ostream &out) override {
-    vector<uint8_t> contents = getContents(in);
-    compress(contents, out);
+  /**
+   * Compress contents after the history and writes triplets to bitbuf
+   * @param ctx context
+   * @param contents the history and the data
+   * @param bout bitbuf
+   * @param depth maximal count of candidates checked for every match
+   * @param primed count of bytes of the history, matches may start in its last window() bytes
+   */
+  void compress(lz77context &ctx, span<const uint8_t> contents, obitbuf &bout, int depth, size_t primed = 0) const {
+    uint64_t i;
+
+    if (primed > contents.size())
+      error("Invalid history size.");
+
+    ctx.reset(window());
+
+    for (i = primed > window() ? primed - window() : 0; i < primed; i++)
+      ctx.insert(i, contents);
+
+    for (i = primed; i < contents.size(); i++) {
+      Triplet triplet = ctx.find(i, contents, window(), lookahead(), depth);
+      addTriplet(triplet, bout);
+
+      for (uint64_t p = i; p <= i + triplet.k; p++)
+        ctx.insert(p, contents);
+
+      i += triplet.k;
+    }
+
+    bout.writeBit(i > contents.size());
   }
 
-  void decompress(istream &in, ostream &out) override {
-    vector<uint8_t> contents = getContents(in);
-    decompress(contents, out);
+  /**
+   * Reads triplets from bitbuf and writes decompressed contents to output, every match is checked
+   * against the window, the lookahead and the decompressed size, so invalid streams raise an error
+   * @param bin bitbuf
+   * @param out output
+   * @param primed count of the last bytes of the output which are the history
+   */
+  void decompress(ibitbuf &bin, obytebuf &out, size_t primed = 0) const {
+    if (primed > out.size())
+      error("Invalid history size.");
+
+    const size_t begin = out.size() - primed;
+    Triplet triplet(0, 0, 0);
+
+    out.keep(window());
+
+    // triplets have the same size and the flag bit with the padding is shorter than a triplet,
+    // so the count of triplets is known and they are read without checking the end of the stream
+    for (uint64_t count = bin.remaining() / (J() + K() + C); count > 0; count--) {
+      getTriplet(triplet, bin);
+
+      if (triplet.k > 0) {
+        if (triplet.j > out.size() - begin || triplet.j > window() || triplet.k > lookahead())
+          error("Invalid lz77 match.");
+
+        out.copyMatch(triplet.j, triplet.k);
+      }
+
+      out.put(triplet.c);
+    }
+
+    // the last flag bit shows that the byte in the last triplet does not exist
+    if (bin.readBit() == 1) {
+      if (out.size() == begin + primed)
+        error("Invalid lz77 stream.");
+
+      out.pop();
+    }
   }
 
  private:
+  unsigned int _window, _lookahead, _j, _k;
+
   /**
-   * Size for storing Triplet's j
+   * Size for storing Triplet's c
    */
-  static constexpr unsigned int J = countBits(S - 1);
+  static constexpr unsigned int C = BYTE_SIZE;
 
   /**
- * Size for storing Triplet's k
- */
-  static constexpr unsigned int K = countBits(T);
+   * Returns window's size
+   * @return window's size
+   */
+  unsigned int window() const {
+    if constexpr (S > 0) return S; else return _window;
+  }
 
   /**
- * Size for storing Triplet's c
- */
-  static constexpr unsigned int C = BYTE_SIZE;
+   * Returns lookahead's size
+   * @return lookahead's size
+   */
+  unsigned int lookahead() const {
+    if constexpr (T > 0) return T; else return _lookahead;
+  }
 
   /**
-   * Gets triplet from bitbuf and returns true if it was successful and false otherwise
-   * @param triplet triplet
-   * @param bin bitbuf
-   * @return returns true if it was successful and false otherwise
+   * Returns size for storing Triplet's j
+   * @return size for storing Triplet's j
    */
-  bool getTriplet(Triplet &triplet, ibitbuf &bin) {
-
-    uint8_t c = 0;
-    uint64_t k = 0;
-    uint64_t j = 0;
+  unsigned int J() const {
+    if constexpr (S > 0) return countBits(S - 1); else return _j;
+  }
 
-    bool res = bin.getData(c, C) && bin.getData(k, K) && bin.getData(j, J);
+  /**
+   * Returns size for storing Triplet's k
+   * @return size for storing Triplet's k
+   */
+  unsigned int K() const {
+    if constexpr (T > 0) return countBits(T); else return _k;
+  }
 
-    triplet.j = j + 1;
-    triplet.k = k;
-    triplet.c = c;
+  /**
+   * Gets triplet from bitbuf without checking if it is available
+   * @param triplet triplet
+   * @param bin bitbuf
+   */
+  void getTriplet(Triplet &triplet, ibitbuf &bin) const {
+    uint64_t result = bin.readData(J() + K() + C);
 
-    return res;
+    triplet.j = (result >> (K() + C)) + 1;
+    triplet.k = (result >> C) & lowMask(K());
+    triplet.c = (uint8_t) result;
   }
 
   /**
@@ -77,96 +290,233 @@ struct lz77 : archiver {
    * @param triplet tirplet
    * @param bout bitbuf
    */
-  void addTriplet(const Triplet &triplet, obitbuf &bout) {
-    uint64_t result = combineNumber(triplet.j - 1, triplet.k, triplet.c, K, C);
-
-    bitset<J + K + C> b(result);
-    int bites_to_write = J + K + C;
+  void addTriplet(const Triplet &triplet, obitbuf &bout) const {
+    uint64_t result = combineNumber(triplet.j - 1, triplet.k, triplet.c, K(), C);
 
-    for (size_t i = 0; i < bites_to_write; i++)
-      bout.writeBit(b[i]);
+    bout.writeData(result, J() + K() + C);
   }
+};
 
+/**
+ * Class for LZ77 compression with sizes of the window and the lookahead fixed at compile time
+ * @tparam S window's size
+ * @tparam T lookahead's size
+ */
+template<int S, int T>
+struct lz77 : archiver {
+ public:
   /**
-   * Finds the next triplet from given contents and index
-   * @param i index
-   * @param contents contents
-   * @return next triplet
+   * Reusable working memory of the match finder
    */
-  Triplet find(int64_t i, const vector<uint8_t> &contents) {
-    int64_t start, end;
-    start = (0 > i - S) ? 0 : i - S;
-    end = i - 1;
+  typedef lz77context context;
 
-    int64_t lstart, lend;
-    lstart = i;
-    lend = (contents.size() - 1 > T + i - 1) ? T + i - 1 : contents.size() - 1;
-
-    int maxLen = 0, j, fndIndex = 0;
-    for (i = start; i <= end; i++) {
-      if (contents[lstart] == contents[i]) {
-        for (j = 0; j + lstart <= lend && contents[j + i] == contents[j + lstart]; j++);
+  /**
+   * Default constructor
+   * @param depth maximal count of candidates checked for every match, by default the whole window
+   */
+  explicit lz77(int depth = S) {
+    _depth = depth;
+  }
 
-        if (j > maxLen) {
-          fndIndex = end - i + 1;
-          maxLen = j;
-        }
-      }
-    }
+  using archiver::compress;
+  using archiver::decompress;
 
-    if (maxLen == 0)
-      fndIndex = 1;
+  size_t compressBound(size_t size) override {
+    return _kernel.compressBound(size);
+  }
 
-    return Triplet(fndIndex, maxLen, contents[lstart + maxLen]);
+  size_t compress(span<const uint8_t> contents, span<uint8_t> out) override {
+    return compress(_ctx, contents, out);
   }
 
   /**
- * Compress contents and writes to output stream
+ * Decompress contents and writes to output
  * @param contents contents
- * @param out output stream
+ * @param out output
  */
-  void compress(const vector<uint8_t> &contents, ostream &out) {
-    obitbuf bout;
-    uint64_t i;
+  void decompress(span<const uint8_t> contents, obytebuf &out) override {
+    ibitbuf bin(contents);
+    _kernel.decompress(bin, out);
+  }
 
-    for (i = 0; i < contents.size(); i++) {
-      Triplet triplet = find(i, contents);
-      addTriplet(triplet, bout);
-      i += triplet.k;
-    }
+  void decompress(istream &in, ostream &out) override {
+    decompressWindowed(in, out);
+  }
 
-    bout.writeBit(i > contents.size());
+  /**
+ * Compress contents using given context and writes to output buffer
+ * @param ctx context
+ * @param contents contents
+ * @param out output buffer
+ * @return count of compressed bytes
+ */
+  size_t compress(context &ctx, span<const uint8_t> contents, span<uint8_t> out) {
+    obitbuf bout(out);
+    _kernel.compress(ctx, contents, bout, _depth);
 
-    bout.writeToStream(out);
+    return bout.flush();
   }
 
+ private:
   /**
- * Decompress contents and writes to output stream
- * @param contents contents
- * @param out output stream
+   * Compression and decompression loops
+   */
+  lz77kernel<S, T> _kernel;
+
+  /**
+   * Maximal count of candidates checked for every match
+   */
+  int _depth;
+
+  /**
+   * Default context
+   */
+  context _ctx;
+};
+
+/**
+ * Class for LZ77 compression with sizes of the window and the lookahead given at runtime,
+ * the sizes are written to the stream's header, so decompression does not need them.
+ * Common sizes are handled by the kernels specialized at compile time, others by the generic one
  */
-  void decompress(const vector<uint8_t> &contents, ostream &out) {
+class lz77dyn : public archiver {
+ public:
+  /**
+   * Reusable working memory of the match finder
+   */
+  typedef lz77context context;
+
+  /**
+   * Size of the header with the sizes
+   */
+  static constexpr unsigned int HEADER_SIZE = 8;
+
+  /**
+   * Default constructor
+   * @param window window's size
+   * @param lookahead lookahead's size
+   * @param depth maximal count of candidates checked for every match, by default the whole window
+   */
+  lz77dyn(unsigned int window, unsigned int lookahead, int depth = 0) {
+    checkSizes(window, lookahead);
+
+    _window = window;
+    _lookahead = lookahead;
+    _depth = depth > 0 ? depth : (int) min<unsigned int>(window, INT32_MAX);
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    return HEADER_SIZE + dispatch(_window, _lookahead, [&](const auto &kernel) {
+      return kernel.compressBound(size);
+    });
+  }
+
+  size_t compress(span<const uint8_t> contents, span<uint8_t> out) override {
+    return compress(_ctx, contents, out);
+  }
+
+  size_t compress(span<const uint8_t> contents, size_t primed, span<uint8_t> out) override {
+    return compress(_ctx, contents, out, primed);
+  }
+
+  void decompress(span<const uint8_t> contents, obytebuf &out) override {
+    decompress(contents, 0, out);
+  }
+
+  void decompress(span<const uint8_t> contents, size_t primed, obytebuf &out) override {
     ibitbuf bin(contents);
 
-    Triplet triplet(0, 0, 0);
-    vector<uint8_t> result;
+    unsigned int window = 0, lookahead = 0;
+    bin.getData(window, 32);
+    bin.getData(lookahead, 32);
+    checkSizes(window, lookahead);
 
-    while (getTriplet(triplet, bin)) {
-      if (triplet.k > 0) {
-        int start = result.size() - triplet.j;
+    dispatch(window, lookahead, [&](const auto &kernel) {
+      kernel.decompress(bin, out, primed);
+      return 0;
+    });
+  }
 
-        for (int j = 0; j < triplet.k; j++)
-          result.push_back(result[start + j]);
-      }
-      result.push_back(triplet.c);
-    }
+  void decompress(istream &in, ostream &out) override {
+    decompressWindowed(in, out);
+  }
+
+  size_t getHistorySize() override {
+    return _window;
+  }
+
+  /**
+   * Compress contents using given context and writes to output buffer
+   * @param ctx context
+   * @param contents contents
+   * @param out output buffer
+   * @param primed count of bytes of the history at the beginning of contents
+   * @return count of compressed bytes
+   */
+  size_t compress(context &ctx, span<const uint8_t> contents, span<uint8_t> out, size_t primed = 0) {
+    obitbuf bout(out);
+
+    bout.writeData(_window, 32);
+    bout.writeData(_lookahead, 32);
+
+    dispatch(_window, _lookahead, [&](const auto &kernel) {
+      kernel.compress(ctx, contents, bout, _depth, primed);
+      return 0;
+    });
+
+    return bout.flush();
+  }
 
-    // checks if byte exists in the last position
-    if (triplet.c != 0)
-        result.pop_back();
+ private:
+  unsigned int _window, _lookahead;
+
+  /**
+   * Maximal count of candidates checked for every match
+   */
+  int _depth;
+
+  /**
+   * Default context
+   */
+  context _ctx;
 
-    for (const uint8_t &val: result)
-      out.put(val);
+  /**
+   * Checks if sizes can be used
+   * @param window window's size
+   * @param lookahead lookahead's size
+   */
+  static void checkSizes(unsigned int window, unsigned int lookahead) {
+    if (window == 0 || lookahead == 0 || countBits(window - 1) + countBits(lookahead) + BYTE_SIZE > 64)
+      error("Invalid lz77 window or lookahead size.");
+  }
+
+  /**
+   * Calls function with the kernel for given sizes
+   * @tparam F function type
+   * @param window window's size
+   * @param lookahead lookahead's size
+   * @param f function
+   * @return result of the function
+   */
+  template<typename F>
+  static size_t dispatch(unsigned int window, unsigned int lookahead, F f) {
+    const unsigned int KB = 1024;
+
+    if (window == 4 * KB && lookahead == KB)
+      return f(lz77kernel<4 * KB, KB>());
+    if (window == 8 * KB && lookahead == 2 * KB)
+      return f(lz77kernel<8 * KB, 2 * KB>());
+    if (window == 16 * KB && lookahead == 4 * KB)
+      return f(lz77kernel<16 * KB, 4 * KB>());
+    if (window == 32 * KB && lookahead == 8 * KB)
+      return f(lz77kernel<32 * KB, 8 * KB>());
+    if (window == 64 * KB && lookahead == 16 * KB)
+      return f(lz77kernel<64 * KB, 16 * KB>());
+
+    return f(lz77kernel<0, 0>(window, lookahead));
   }
 };
 
@@ -0,0 +1,594 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_LZ77LONG_HPP_
+#define HW_ARCHIVER_LIB_LZ77LONG_HPP_
+
+#include "lz77.hpp"
+#include <thread>
+
+/**
+ * Table of long distance matches: positions are sampled by the rolling hash of the next MIN_MATCH bytes,
+ * so the same contents are sampled at the same places wherever they are, and only sampled positions are
+ * kept, one per cell. Its memory is proportional to the window divided by the sampling rate
+ */
+struct ldmtable {
+  /**
+   * Length of the hashed bytes, the shortest long distance match
+   */
+  static constexpr int64_t MIN_MATCH = 32;
+
+  /**
+   * Count of bits of the sampling, every 2^SAMPLE_BITS-th position is sampled on average
+   */
+  static constexpr unsigned int SAMPLE_BITS = 6;
+
+  /**
+   * Multiplier of the rolling hash
+   */
+  static constexpr uint64_t PRIME = 0x100000001B3ULL;
+
+  /**
+   * Hash of every cell
+   */
+  vector<uint64_t> hashes;
+
+  /**
+   * Position of every cell
+   */
+  vector<int64_t> positions;
+
+  /**
+   * Count of bits of the cell index
+   */
+  unsigned int bits{0};
+
+  /**
+   * PRIME ^ (MIN_MATCH - 1), used for removing the oldest byte from the hash
+   */
+  uint64_t outFactor{0};
+
+  /**
+   * Forgets all positions
+   * @param window window's size
+   */
+  void reset(uint64_t window) {
+    bits = max<unsigned int>(countBits((window - 1) >> SAMPLE_BITS), 8);
+
+    hashes.assign((size_t) 1 << bits, 0);
+    positions.assign((size_t) 1 << bits, -1);
+
+    outFactor = 1;
+    for (int64_t i = 1; i < MIN_MATCH; i++)
+      outFactor *= PRIME;
+  }
+
+  /**
+   * Counts and returns the hash of MIN_MATCH bytes starting at the index
+   * @param i index
+   * @param contents contents
+   * @return the hash
+   */
+  static uint64_t hash(int64_t i, span<const uint8_t> contents) {
+    uint64_t h = 0;
+
+    for (int64_t k = 0; k < MIN_MATCH; k++)
+      h = h * PRIME + contents[i + k] + 1;
+
+    return h;
+  }
+
+  /**
+   * Moves the hash one byte forward
+   * @param h hash of MIN_MATCH bytes starting at the index
+   * @param i index
+   * @param contents contents, at least MIN_MATCH + 1 bytes starting at the index
+   * @return hash of MIN_MATCH bytes starting at the next index
+   */
+  uint64_t roll(uint64_t h, int64_t i, span<const uint8_t> contents) const {
+    return (h - (contents[i] + 1) * outFactor) * PRIME + contents[i + MIN_MATCH] + 1;
+  }
+
+  /**
+   * Mixes bits of the hash, the low bits of the rolling hash are weak
+   * @param h hash
+   * @return mixed hash
+   */
+  static uint64_t mix(uint64_t h) {
+    return (h ^ (h >> 29)) * 0xBF58476D1CE4E5B9ULL;
+  }
+
+  /**
+   * Checks if the position with the hash is sampled
+   * @param h hash
+   * @return true if the position is sampled and false otherwise
+   */
+  static bool sampled(uint64_t h) {
+    return (mix(h) >> (64 - SAMPLE_BITS)) == 0;
+  }
+
+  /**
+   * Returns the cell of the hash
+   * @param h hash
+   * @return the cell of the hash
+   */
+  size_t cell(uint64_t h) const {
+    return (mix(h) >> (64 - SAMPLE_BITS - bits)) & lowMask(bits);
+  }
+
+  /**
+   * Adds sampled position
+   * @param i index
+   * @param h hash at the index
+   */
+  void insert(int64_t i, uint64_t h) {
+    size_t c = cell(h);
+    hashes[c] = h;
+    positions[c] = i;
+  }
+
+  /**
+   * Finds the long distance match for the sampled position
+   * @param i index
+   * @param h hash at the index
+   * @param contents contents
+   * @param window window's size
+   * @param lend maximal length of the match
+   * @param fndIndex distance of the match
+   * @return length of the match or zero if there is no match
+   */
+  int64_t find(int64_t i, uint64_t h, span<const uint8_t> contents, int64_t window, int64_t lend,
+               int64_t &fndIndex) const {
+    size_t c = cell(h);
+    int64_t cand = positions[c];
+
+    if (cand < 0 || hashes[c] != h || i - cand > window)
+      return 0;
+
+    int64_t j = lend > 0 ? cpu::matchLength(&contents[cand], &contents[i], lend) : 0;
+
+    fndIndex = i - cand;
+    return j;
+  }
+};
+
+/**
+ * Class for LZ77 compression with large windows (up to 64 MB). Near matches are found by the hash chains
+ * in a short window, far ones by the table of long distance matches. Triplets have variable size:
+ * k is Elias gamma coded, j is coded by its bits count and bits, so single bytes cost 9 bits.
+ * Large inputs may be parsed by several threads: the input is split to segments, every segment's
+ * match finders are filled by the window before it, so matches still reach the previous segments,
+ * but matches end inside their segment. The stream is the same as of one parse with such cuts
+ */
+class lz77long : public archiver {
+ public:
+  /**
+   * Maximal window's size
+   */
+  static constexpr uint64_t MAX_WINDOW = (uint64_t) 64 << 20;
+
+  /**
+   * Maximal length of the match
+   */
+  static constexpr uint64_t MAX_LOOKAHEAD = (uint64_t) 16 << 20;
+
+  /**
+   * Maximal size of the short window searched by the hash chains
+   */
+  static constexpr uint64_t SHORT_WINDOW = (uint64_t) 256 << 10;
+
+  /**
+   * Size of the header: window's size, lookahead's size and count of bytes
+   */
+  static constexpr unsigned int HEADER_SIZE = 16;
+
+  /**
+   * Minimal size of the segment parsed by one thread
+   */
+  static constexpr uint64_t MIN_SEGMENT = (uint64_t) 1 << 20;
+
+  /**
+   * Reusable working memory of the match finders
+   */
+  struct context {
+    /**
+     * Hash chains of the short window
+     */
+    lz77context chains;
+
+    /**
+     * Table of long distance matches
+     */
+    ldmtable ldm;
+
+    /**
+     * Triplets of the segment parsed by the thread
+     */
+    vector<uint8_t> buffer;
+
+    /**
+     * Count of bits in the buffer
+     */
+    uint64_t bits{0};
+  };
+
+  /**
+   * Parse strategies: the greedy parse takes the longest match at every position, the lazy one
+   * also checks the next position and codes the byte alone if a longer match starts there
+   */
+  enum parses { GREEDY = 0, LAZY = 1 };
+
+  /**
+   * Default constructor
+   * @param window window's size, at most MAX_WINDOW
+   * @param lookahead maximal length of the match, at most MAX_LOOKAHEAD
+   * @param depth maximal count of candidates checked by the hash chains for every match
+   * @param threads maximal count of threads parsing the input
+   * @param parse parse strategy, the stream does not depend on it
+   */
+  explicit lz77long(uint64_t window = MAX_WINDOW, unsigned int lookahead = 1 << 16, int depth = 64,
+                    unsigned int threads = 1, parses parse = GREEDY) {
+    if (window == 0 || window > MAX_WINDOW || lookahead == 0 || lookahead > MAX_LOOKAHEAD)
+      error("Invalid lz77long window or lookahead size.");
+
+    _window = window;
+    _lookahead = lookahead;
+    _depth = depth;
+    _threads = max(threads, 1u);
+    _parse = parse;
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    // matches are used only if they are shorter than single bytes
+    return HEADER_SIZE + (size * 9 + BYTE_SIZE - 1) / BYTE_SIZE + BYTE_SIZE;
+  }
+
+  size_t compress(span<const uint8_t> contents, span<uint8_t> out) override {
+    return compress(contents, 0, out);
+  }
+
+  size_t compress(span<const uint8_t> contents, size_t primed, span<uint8_t> out) override {
+    const size_t size = contents.size() - primed;
+    size_t segments = min<uint64_t>(_threads, size / MIN_SEGMENT);
+
+    if (segments <= 1)
+      return compress(_ctx, contents, primed, out);
+
+    _contexts.resize(segments);
+    vector<thread> threads;
+    vector<exception_ptr> failures(segments);
+
+    for (size_t s = 0; s < segments; s++) {
+      threads.emplace_back([&, s]() {
+        try {
+          context &ctx = _contexts[s];
+          int64_t begin = primed + size * s / segments, end = primed + size * (s + 1) / segments;
+
+          ctx.buffer.resize(compressBound(end - begin));
+          obitbuf sout(ctx.buffer);
+          parse(ctx, contents, begin, end, sout);
+          ctx.bits = sout.bitCount();
+          sout.flush();
+        } catch (...) {
+          failures[s] = current_exception();
+        }
+      });
+    }
+
+    for (auto &t: threads)
+      t.join();
+
+    for (auto &failure: failures)
+      if (failure)
+        rethrow_exception(failure);
+
+    obitbuf bout(out);
+    writeHeader(size, bout);
+
+    for (const context &ctx: _contexts)
+      appendBits(ctx.buffer, ctx.bits, bout);
+
+    return bout.flush();
+  }
+
+  void decompress(span<const uint8_t> contents, obytebuf &out) override {
+    decompress(contents, 0, out);
+  }
+
+  void decompress(span<const uint8_t> contents, size_t primed, obytebuf &out) override {
+    ibitbuf bin(contents);
+
+    uint64_t window = 0, lookahead = 0, size = 0;
+    bin.getData(window, 32);
+    bin.getData(lookahead, 32);
+    bin.getData(size, 64);
+
+    if (window == 0 || window > MAX_WINDOW || lookahead == 0 || lookahead > MAX_LOOKAHEAD)
+      error("Invalid lz77long window or lookahead size.");
+
+    if (primed > out.size())
+      error("Invalid history size.");
+
+    out.keep(window);
+    size_t begin = out.size();
+
+    while (out.size() - begin < size) {
+      Triplet triplet = getTriplet(bin);
+      uint64_t produced = out.size() - begin;
+
+      if (triplet.k > lookahead)
+        error("Invalid lz77 stream.");
+
+      if (triplet.k > 0) {
+        if (triplet.j > primed + produced || triplet.j > window || triplet.k >= size - produced)
+          error("Invalid lz77long match.");
+
+        out.copyMatch(triplet.j, triplet.k);
+      }
+
+      out.put(triplet.c);
+    }
+  }
+
+  void decompress(istream &in, ostream &out) override {
+    decompressWindowed(in, out);
+  }
+
+  size_t getHistorySize() override {
+    return _window;
+  }
+
+  /**
+   * Compress contents using given context and writes to output buffer
+   * @param ctx context
+   * @param contents contents
+   * @param out output buffer
+   * @return count of compressed bytes
+   */
+  size_t compress(context &ctx, span<const uint8_t> contents, span<uint8_t> out) {
+    return compress(ctx, contents, 0, out);
+  }
+
+  /**
+   * Compress the end of contents after the history using given context and writes to output buffer
+   * @param ctx context
+   * @param contents the history and the data
+   * @param primed count of bytes of the history
+   * @param out output buffer
+   * @return count of compressed bytes
+   */
+  size_t compress(context &ctx, span<const uint8_t> contents, size_t primed, span<uint8_t> out) {
+    if (primed > contents.size())
+      error("Invalid history size.");
+
+    obitbuf bout(out);
+    writeHeader(contents.size() - primed, bout);
+    parse(ctx, contents, primed, contents.size(), bout);
+
+    return bout.flush();
+  }
+
+ private:
+  uint64_t _window;
+  unsigned int _lookahead;
+
+  /**
+   * Maximal count of candidates checked by the hash chains for every match
+   */
+  int _depth;
+
+  /**
+   * Maximal count of threads parsing the input
+   */
+  unsigned int _threads;
+
+  parses _parse;
+
+  /**
+   * Default context
+   */
+  context _ctx;
+
+  /**
+   * Contexts of the threads
+   */
+  vector<context> _contexts;
+
+  /**
+   * Writes the header
+   * @param size count of bytes
+   * @param bout bitbuf
+   */
+  void writeHeader(uint64_t size, obitbuf &bout) const {
+    bout.writeData(_window, 32);
+    bout.writeData(_lookahead, 32);
+    bout.writeData(size, 64);
+  }
+
+  /**
+   * Appends bits written by other bitbuf
+   * @param bits buffer with the bits
+   * @param count count of bits
+   * @param bout bitbuf
+   */
+  static void appendBits(span<const uint8_t> bits, uint64_t count, obitbuf &bout) {
+    ibitbuf bin(bits);
+
+    for (; count >= 32; count -= 32)
+      bout.writeData(bin.readData(32), 32);
+
+    bout.writeData(bin.readData(count), count);
+  }
+
+  /**
+   * Parses the segment of contents to triplets, the match finders are filled by the window before it
+   * and matches end inside the segment
+   * @param ctx context
+   * @param contents contents
+   * @param begin index of the segment's first byte
+   * @param end index after the segment's last byte
+   * @param bout bitbuf
+   */
+  void parse(context &ctx, span<const uint8_t> contents, int64_t begin, int64_t end, obitbuf &bout) {
+    const int64_t n = end;
+    const int64_t shortWindow = min(_window, SHORT_WINDOW);
+    const bool useLdm = _window > SHORT_WINDOW;
+
+    // the match finders see only bytes before the end, so matches and their next bytes stay inside
+    contents = contents.subspan(0, end);
+
+    ctx.chains.reset(shortWindow);
+    for (int64_t p = max<int64_t>(begin - shortWindow, 0); p < begin; p++)
+      ctx.chains.insert(p, contents);
+
+    uint64_t h = 0;
+
+    if (useLdm) {
+      ctx.ldm.reset(_window);
+
+      int64_t from = max<int64_t>(begin - _window, 0);
+      if (from + ldmtable::MIN_MATCH <= n)
+        h = ldmtable::hash(from, contents);
+
+      for (int64_t p = from; p < begin && p + ldmtable::MIN_MATCH <= n; p++) {
+        if (ldmtable::sampled(h))
+          ctx.ldm.insert(p, h);
+
+        if (p + ldmtable::MIN_MATCH < n)
+          h = ctx.ldm.roll(h, p, contents);
+      }
+    }
+
+    // finds the match at the index, h has to be the hash at it
+    auto findMatch = [&](int64_t i) {
+      Triplet triplet = ctx.chains.find(i, contents, shortWindow, _lookahead, _depth);
+
+      if (useLdm && i + ldmtable::MIN_MATCH <= n && ldmtable::sampled(h)) {
+        int64_t fndIndex = 1, lend = min<int64_t>(_lookahead, n - 1 - i);
+        int64_t len = ctx.ldm.find(i, h, contents, _window, lend, fndIndex);
+
+        if (len > (int64_t) triplet.k)
+          triplet = Triplet(fndIndex, len, contents[i + len]);
+      }
+
+      if (triplet.k > 0 && tripletSize(triplet) >= 9 * (triplet.k + 1))
+        triplet = Triplet(1, 0, contents[i]);
+
+      return triplet;
+    };
+
+    // adds the position to the match finders and moves the hash to the next one
+    auto advance = [&](int64_t p) {
+      ctx.chains.insert(p, contents);
+
+      if (useLdm && p + ldmtable::MIN_MATCH <= n) {
+        if (ldmtable::sampled(h))
+          ctx.ldm.insert(p, h);
+
+        if (p + ldmtable::MIN_MATCH < n)
+          h = ctx.ldm.roll(h, p, contents);
+      }
+    };
+
+    // positions before it are in the match finders
+    int64_t inserted = begin;
+
+    // the match at the next index found by the lazy parse
+    Triplet next(1, 0, 0);
+    bool found = false;
+
+    for (int64_t i = begin; i < n;) {
+      Triplet triplet = found ? next : findMatch(i);
+      found = false;
+
+      // the lazy parse codes the byte alone if the next byte starts a longer match
+      if (_parse == LAZY && triplet.k > 0) {
+        advance(inserted++);
+        next = findMatch(i + 1);
+
+        if (next.k > triplet.k) {
+          triplet = Triplet(1, 0, contents[i]);
+          found = true;
+        }
+      }
+
+      addTriplet(triplet, bout);
+
+      for (; inserted <= i + (int64_t) triplet.k; inserted++)
+        advance(inserted);
+
+      i += triplet.k + 1;
+    }
+  }
+
+  /**
+   * Counts and returns size of the triplet in bits
+   * @param triplet triplet
+   * @return size of the triplet in bits
+   */
+  static uint64_t tripletSize(const Triplet &triplet) {
+    uint64_t size = 2 * countBits(triplet.k + 1) - 1 + BYTE_SIZE;
+
+    if (triplet.k > 0)
+      size += 5 + countBits(triplet.j - 1);
+
+    return size;
+  }
+
+  /**
+   * Adds triplet to bitbuf
+   * @param triplet tirplet
+   * @param bout bitbuf
+   */
+  static void addTriplet(const Triplet &triplet, obitbuf &bout) {
+    uint64_t k = triplet.k + 1;
+    unsigned int kBits = countBits(k);
+
+    // Elias gamma code: zeros, the stop bit and the bits after the leading one
+    bout.writeData((uint64_t) 1 << (kBits - 1), kBits);
+    bout.writeData(k, kBits - 1);
+
+    if (triplet.k > 0) {
+      unsigned int jBits = countBits(triplet.j - 1);
+      bout.writeData(jBits, 5);
+      bout.writeData(triplet.j - 1, jBits);
+    }
+
+    bout.writeData(triplet.c, BYTE_SIZE);
+  }
+
+  /**
+   * Gets triplet from bitbuf
+   * @param bin bitbuf
+   * @return triplet
+   */
+  static Triplet getTriplet(ibitbuf &bin) {
+    unsigned int kBits = 1;
+    int bit;
+
+    while ((bit = bin.readBit()) == 0 && kBits < 64)
+      kBits++;
+
+    if (bit != 1)
+      error("Unexpected end of stream.");
+
+    uint64_t k = bin.readData(kBits - 1) | ((uint64_t) 1 << (kBits - 1));
+    uint64_t j = 1;
+
+    if (k > 1)
+      j = bin.readData(bin.readData(5)) + 1;
+
+    uint64_t c = bin.readData(BYTE_SIZE);
+
+    if (bin.overrun())
+      error("Unexpected end of stream.");
+
+    return Triplet(j, k - 1, c);
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_LZ77LONG_HPP_
@@ -13,104 +13,317 @@
  */
 class lzw : public archiver {
  public:
+  /**
+   * Reusable dictionaries for compression and decompression, words are stored as (prefix code, byte) pairs,
+   * after the first call compression and decompression do not allocate
+   */
+  struct context {
+    /**
+     * Cell of the compression dictionary's hash table
+     */
+    struct cell {
+      /**
+       * (prefix code << 8) | byte
+       */
+      uint32_t key;
+
+      uint32_t code;
+
+      /**
+       * Cell is used only if its stamp equals to the current one
+       */
+      uint32_t stamp;
+    };
+
+    /**
+     * Hash table of the compression dictionary, every probe reads one cell
+     */
+    vector<cell> cells;
+
+    /**
+     * Current stamp, changing it clears the hash table
+     */
+    uint32_t stamp{0};
+
+    /**
+     * Count of bits of the hash table's cell index
+     */
+    unsigned int bits{0};
+
+    /**
+     * Words of the decompression dictionary packed to 8 bytes: (length << 32) | (prefix code << 8) | last byte,
+     * so the word is unpacked by one load per byte
+     */
+    vector<uint64_t> words;
+
+    /**
+     * Prepares the compression dictionary
+     * @param maxSize maximal code
+     */
+    void resetCompression(unsigned int maxSize) {
+      bits = countBits(2 * (maxSize + 1));
+      size_t size = (size_t) 1 << bits;
+
+      if (cells.size() != size) {
+        cells.assign(size, cell());
+        stamp = 0;
+      }
+
+      if (++stamp == 0) {
+        for (auto &c: cells)
+          c.stamp = 0;
+        stamp = 1;
+      }
+    }
+
+    /**
+     * Prepares the decompression dictionary, the words of single bytes are set only once
+     * @param maxSize maximal code
+     */
+    void resetDecompression(unsigned int maxSize) {
+      if (words.size() == maxSize + 1)
+        return;
+
+      words.assign(maxSize + 1, 0);
+
+      for (int i = 0; i < MAX_CHAR; i++)
+        words[i] = ((uint64_t) 1 << 32) | i;
+    }
+
+    /**
+     * Finds code of the word in the compression dictionary
+     * @param key (prefix code << 8) | byte
+     * @param index index of the word's cell or the empty cell for it
+     * @return true if the word was found and false otherwise
+     */
+    bool find(uint32_t key, size_t &index) const {
+      size_t mask = cells.size() - 1;
+
+      for (index = (key * 0x9E3779B97F4A7C15ULL) >> (64 - bits); cells[index].stamp == stamp;
+           index = (index + 1) & mask)
+        if (cells[index].key == key)
+          return true;
+
+      return false;
+    }
+  };
+
   /**
    * Default constrcutor
    * @param wordLength word length for compression
    */
   explicit lzw(const int &wordLength) {
+    // the dictionary has to hold all single bytes and prefix codes are packed to 24 bits
+    if (wordLength <= BYTE_SIZE + 1 || wordLength > 24)
+      error("Invalid lzw word length.");
+
     _wordLength = wordLength;
   }
 
-  void compress(const string &inFileName, const string &outFileName) override {
-    archiver::compress(inFileName, outFileName);
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    // every code encodes at least one byte
+    return (size * _wordLength + BYTE_SIZE - 1) / BYTE_SIZE;
+  }
+
+  size_t compress(span<const uint8_t> contents, span<uint8_t> out) override {
+    return compress(_ctx, contents, out);
   }
 
-  void decompress(const string &inFileName, const string &outFileName) override {
-    archiver::decompress(inFileName, outFileName);
+  size_t compress(span<const uint8_t> contents, size_t primed, span<uint8_t> out) override {
+    return compress(_ctx, contents, out, primed);
   }
 
-  void compress(istream& in, ostream& out) override {
-    vector<uint8_t> contents = getContents(in);
-    compress(contents, out);
+  void decompress(span<const uint8_t> contents, obytebuf &out) override {
+    decompress(_ctx, contents, out);
+  }
+
+  void decompress(span<const uint8_t> contents, size_t primed, obytebuf &out) override {
+    decompress(_ctx, contents, out, primed);
   }
 
   void decompress(istream &in, ostream &out) override {
-    vector<uint8_t> contents = getContents(in);
-    decompress(contents, out);
+    decompressWindowed(in, out);
   }
 
- private:
-  /**
-   * word length fro compression
-   */
-  int _wordLength;
+  size_t getHistorySize() override {
+    return HISTORY_SIZE;
+  }
 
   /**
-   * Compress contents and writes to output stream
+   * Compress contents using given context and writes to output buffer
+   * @param ctx context
    * @param contents contents
-   * @param out output stream
+   * @param out output buffer
+   * @param primed count of bytes of the history at the beginning of contents, its words are in the dictionary
+   * @return count of compressed bytes
    */
-  void compress(const vector<uint8_t> &contents, ostream &out) {
-    int MAX_SIZE = 1 << (_wordLength - 1);
+  size_t compress(context &ctx, span<const uint8_t> contents, span<uint8_t> out, size_t primed = 0) {
+    unsigned int MAX_SIZE = 1 << (_wordLength - 1);
 
-    unordered_map<string, unsigned int> dict(MAX_SIZE);
-    for (int i = 0; i < MAX_CHAR; i++)
-      dict[string(1, i)] = i;
+    if (primed > contents.size())
+      error("Invalid history size.");
 
-    obitbuf bout;
+    ctx.resetCompression(MAX_SIZE);
+    unsigned int ind = prime(ctx, contents.subspan(0, primed), MAX_SIZE, false);
 
-    string curr;
-    unsigned int ind = MAX_CHAR + 1;
+    obitbuf bout(out);
 
-    for (const uint8_t& c: contents) {
-      curr += c;
-      if (dict.find(curr) == dict.end()) {
-        if (ind <= MAX_SIZE)
-          dict[curr] = ind++;
+    if (contents.size() == primed)
+      return bout.flush();
 
-        curr.erase(curr.size() - 1);
-        bout.writeBits(dict[curr], _wordLength);
+    uint32_t curr = contents[primed];
+    size_t index;
 
-        curr = c;
+    for (size_t i = primed + 1; i < contents.size(); i++) {
+      uint8_t c = contents[i];
+      uint32_t key = (curr << BYTE_SIZE) | c;
+
+      if (ctx.find(key, index)) {
+        curr = ctx.cells[index].code;
+        continue;
       }
+
+      if (ind <= MAX_SIZE)
+        ctx.cells[index] = {key, ind++, ctx.stamp};
+
+      bout.writeDataReverse(curr, _wordLength);
+
+      curr = c;
     }
 
-    if (!curr.empty())
-      bout.writeBits(dict[curr], _wordLength);
+    bout.writeDataReverse(curr, _wordLength);
 
-    bout.writeToStream(out);
+    return bout.flush();
   }
 
   /**
- * Decompress contents and writes to output stream
- * @param contents contents
- * @param out output stream
- */
-  void decompress(const vector<uint8_t> &contents, ostream &out) {
-    int MAX_SIZE = 1 << (_wordLength - 1);
+   * Decompress contents using given context and writes to output
+   * @param ctx context
+   * @param contents contents
+   * @param out output
+   * @param primed count of the last bytes of the output which are the history
+   */
+  void decompress(context &ctx, span<const uint8_t> contents, obytebuf &out, size_t primed = 0) {
+    unsigned int MAX_SIZE = 1 << (_wordLength - 1);
 
-    unordered_map<unsigned int, string> dict(MAX_SIZE);
-    for (int i = 0; i < MAX_CHAR; i++)
-      dict[i] = string(1, i);
+    ctx.resetDecompression(MAX_SIZE);
+
+    unsigned int ind = MAX_CHAR + 1;
+
+    if (primed > 0) {
+      ctx.resetCompression(MAX_SIZE);
+      ind = prime(ctx, span<const uint8_t>(out.tail(primed), primed), MAX_SIZE, true);
+    }
 
     ibitbuf bin(contents);
 
     unsigned int code;
-    unsigned int ind = MAX_CHAR + 1;
 
-    string curr;
+    int64_t curr = -1;
 
     while (bin.getDataReverse(code, _wordLength)) {
-      if (dict.find(code) == dict.end())
-        dict[code] = curr + curr[0];
+      uint8_t first;
+
+      if (code < MAX_CHAR) {
+        first = code;
+        out.put(first);
+      } else if (code > MAX_CHAR && code < ind) {
+        first = getWord(ctx, code, out);
+      } else if (code == ind && curr >= 0 && ind <= MAX_SIZE) {
+        // the word is not in the dictionary yet, it is the previous word and its first byte
+        first = getWord(ctx, curr, out);
+        out.put(first);
+      } else {
+        error("Invalid code.");
+      }
+
+      if (curr >= 0 && ind <= MAX_SIZE)
+        ctx.words[ind++] = (((ctx.words[curr] >> 32) + 1) << 32) | ((uint32_t) curr << BYTE_SIZE) | first;
+
+      curr = code;
+    }
+  }
+
+ private:
+  /**
+   * word length fro compression
+   */
+  int _wordLength;
+
+  /**
+   * Count of the last bytes of the history added to the dictionary, the dictionary of long words is filled
+   * by about this count of bytes of text
+   */
+  static constexpr size_t HISTORY_SIZE = 1 << 20;
+
+  /**
+   * Default context
+   */
+  context _ctx;
+
+  /**
+   * Adds the words of the history to the dictionaries as the compression adds them, the last word
+   * of the history is not continued by the data
+   * @param ctx context, its compression dictionary has to be reset
+   * @param history history
+   * @param maxSize maximal code
+   * @param words true for adding the words to the decompression dictionary too
+   * @return the next code
+   */
+  static unsigned int prime(context &ctx, span<const uint8_t> history, unsigned int maxSize, bool words) {
+    unsigned int ind = MAX_CHAR + 1;
+
+    if (history.empty())
+      return ind;
+
+    uint32_t curr = history[0];
+    size_t index;
+
+    for (size_t i = 1; i < history.size(); i++) {
+      uint8_t c = history[i];
+      uint32_t key = (curr << BYTE_SIZE) | c;
+
+      if (ctx.find(key, index)) {
+        curr = ctx.cells[index].code;
+        continue;
+      }
 
-      out << dict[code];
+      if (ind <= maxSize) {
+        ctx.cells[index] = {key, ind, ctx.stamp};
 
-      if (!curr.empty() && ind <= MAX_SIZE)
-        dict[ind++] = curr + dict[code][0];
+        if (words)
+          ctx.words[ind] = (((ctx.words[curr] >> 32) + 1) << 32) | (curr << BYTE_SIZE) | c;
 
-      curr = dict[code];
+        ind++;
+      }
+
+      curr = c;
+    }
+
+    return ind;
+  }
+
+  /**
+   * Writes the word of the code to output, from its last byte to the first one
+   * @param ctx context
+   * @param code code
+   * @param out output
+   * @return the word's first byte
+   */
+  uint8_t getWord(context &ctx, uint32_t code, obytebuf &out) {
+    uint64_t word = ctx.words[code];
+    uint32_t length = word >> 32;
+    uint8_t *dst = out.extend(length);
+
+    for (uint32_t i = length; i-- > 0;) {
+      dst[i] = (uint8_t) word;
+      word = ctx.words[(uint32_t) word >> BYTE_SIZE];
     }
+
+    return dst[0];
   }
 };
 
@@ -0,0 +1,138 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_MEMTRACK_HPP_
+#define HW_ARCHIVER_LIB_MEMTRACK_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/**
+ * Counters of the memory allocated by operator new. The translation unit which defines HW_ARCHIVER_TRACK_MEMORY
+ * before including this header replaces the global operator new and delete by the tracking ones, then all
+ * allocations of the program are counted, otherwise the counters stay zero. The peak is reset before
+ * an operation and read after it, so it is the operation's peak over the memory allocated before it
+ */
+struct memtrack {
+  /**
+   * Count of bytes before every block, keeps the default alignment of new
+   */
+  static constexpr size_t PREFIX_SIZE = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+  /**
+   * Count of allocated bytes
+   */
+  static inline atomic<size_t> current{0};
+
+  /**
+   * The largest count of allocated bytes since the last reset
+   */
+  static inline atomic<size_t> peak{0};
+
+  /**
+   * Counts allocated block
+   * @param size size of the block
+   */
+  static void add(size_t size) {
+    size_t now = current += size;
+    size_t top = peak.load(memory_order_relaxed);
+
+    while (now > top && !peak.compare_exchange_weak(top, now, memory_order_relaxed)) {
+    }
+  }
+
+  /**
+   * Counts freed block
+   * @param size size of the block
+   */
+  static void remove(size_t size) {
+    current -= size;
+  }
+
+  /**
+   * Starts the operation: the peak becomes the current count
+   * @return the current count
+   */
+  static size_t reset() {
+    size_t now = current.load();
+    peak = now;
+
+    return now;
+  }
+
+  /**
+   * Allocates block and counts it, the block's size is stored before it
+   * @param size size of the block
+   * @return the block or nullptr
+   */
+  static void *allocate(size_t size) {
+    auto *p = (uint8_t *) malloc(size + PREFIX_SIZE);
+
+    if (!p)
+      return nullptr;
+
+    *(size_t *) p = size;
+    add(size);
+
+    return p + PREFIX_SIZE;
+  }
+
+  /**
+   * Frees block allocated by allocate
+   * @param ptr the block or nullptr
+   */
+  static void deallocate(void *ptr) {
+    if (!ptr)
+      return;
+
+    uint8_t *p = (uint8_t *) ptr - PREFIX_SIZE;
+    remove(*(size_t *) p);
+    free(p);
+  }
+};
+
+#ifdef HW_ARCHIVER_TRACK_MEMORY
+void *operator new(size_t size) {
+  void *p = memtrack::allocate(size);
+
+  if (!p)
+    throw bad_alloc();
+
+  return p;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept {
+  return memtrack::allocate(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept {
+  return memtrack::allocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  memtrack::deallocate(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  memtrack::deallocate(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  memtrack::deallocate(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+  memtrack::deallocate(ptr);
+}
+#endif
+
+#endif //HW_ARCHIVER_LIB_MEMTRACK_HPP_
@@ -0,0 +1,295 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_PIPELINE_HPP_
+#define HW_ARCHIVER_LIB_PIPELINE_HPP_
+
+#include "blockwise.hpp"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Archiver which compresses streams and files in the blockwise format by a pipeline: the reader thread
+ * fills input buffers, workers compress or decompress them, the calling thread writes results in order.
+ * Every worker has its own blockwise archiver, buffers are reused, and at most `depth` blocks per worker
+ * are in flight, so the reader waits for the writer when the output is slow and the memory is bounded.
+ * Buffers are compressed and decompressed by the first worker's archiver
+ */
+class pipeline : public archiver {
+ public:
+  /**
+   * Factory of the workers' archivers
+   */
+  typedef function<blockwise *()> factory;
+
+  /**
+   * Default constructor
+   * @param create factory of archivers, every archiver has to write the same format
+   * @param threads count of workers, by default the count of hardware threads
+   * @param depth count of buffers per worker, 2 for double buffering
+   */
+  explicit pipeline(const factory &create, unsigned int threads = 0, unsigned int depth = 2) {
+    if (threads == 0)
+      threads = max(thread::hardware_concurrency(), 1u);
+
+    for (unsigned int i = 0; i < threads; i++)
+      _workers.emplace_back(create());
+
+    _slots.resize(threads * max(depth, 1u));
+  }
+
+  using archiver::compress;
+  using archiver::decompress;
+
+  size_t compressBound(size_t size) override {
+    return _workers[0]->compressBound(size);
+  }
+
+  size_t compress(span<const uint8_t> in, span<uint8_t> out) override {
+    return _workers[0]->compress(in, out);
+  }
+
+  void decompress(span<const uint8_t> in, obytebuf &out) override {
+    _workers[0]->decompress(in, out);
+  }
+
+  void compress(istream &in, ostream &out) override {
+    const size_t blockSize = _workers[0]->getBlockSize();
+    const size_t bound = _workers[0]->compressBound(blockSize);
+    xxhash64 streamHash;
+
+    run([&](slot &s) {
+      s.input.resize(blockSize);
+      in.read((char *) s.input.data(), blockSize);
+      s.input.resize(in.gcount());
+
+      return !s.input.empty();
+    }, [&](blockwise &codec, slot &s) {
+      s.output.resize(bound);
+      s.size = codec.compressBlock(s.input, s.output, s.hash);
+    }, [&](slot &s) {
+      out.write((const char *) s.output.data(), s.size);
+      blockwise::addBlockHash(streamHash, s.hash);
+    });
+
+    uint8_t trailer[blockwise::TRAILER_SIZE];
+    blockwise::writeTrailer(trailer, streamHash);
+    out.write((const char *) trailer, sizeof(trailer));
+  }
+
+  void decompress(istream &in, ostream &out) override {
+    uint8_t trailer[blockwise::TRAILER_SIZE];
+    bool ended = false;
+    xxhash64 streamHash;
+
+    run([&](slot &s) {
+      s.input.resize(blockwise::HEADER_SIZE);
+
+      if (!in.read((char *) s.input.data(), 1))
+        error("Unexpected end of stream.");
+
+      if (s.input[0] == blockwise::END) {
+        if (!in.read((char *) trailer + 1, blockwise::TRAILER_SIZE - 1) || in.peek() != EOF)
+          error("Unexpected end of stream.");
+
+        trailer[0] = blockwise::END;
+        ended = true;
+        return false;
+      }
+
+      if (!in.read((char *) s.input.data() + 1, blockwise::HEADER_SIZE - 1))
+        error("Unexpected end of stream.");
+
+      // the payload is read by chunks, so the buffer grows only by the bytes which arrive and a damaged size
+      // does not allocate more than the stream has
+      size_t payloadSize = blockwise::getPayloadSize(s.input.data());
+
+      for (size_t read = 0; read < payloadSize;) {
+        size_t chunk = min<size_t>(payloadSize - read, READ_CHUNK);
+        s.input.resize(blockwise::HEADER_SIZE + read + chunk);
+
+        if (!in.read((char *) s.input.data() + blockwise::HEADER_SIZE + read, chunk))
+          error("Unexpected end of stream.");
+
+        read += chunk;
+      }
+
+      return true;
+    }, [&](blockwise &codec, slot &s) {
+      obytebuf bout(s.output);
+      s.hash = codec.decompressBlock(s.input, bout);
+      s.size = bout.size();
+    }, [&](slot &s) {
+      out.write((const char *) s.output.data(), s.size);
+      blockwise::addBlockHash(streamHash, s.hash);
+    });
+
+    // the reader has finished, so the flag is seen by this thread
+    if (!ended)
+      error("Unexpected end of stream.");
+
+    blockwise::checkTrailer(trailer, streamHash);
+  }
+
+ private:
+  /**
+   * Count of bytes of the payload read at once by the decoder
+   */
+  static constexpr size_t READ_CHUNK = 1 << 20;
+
+  /**
+   * Buffers of one block
+   */
+  struct slot {
+    vector<uint8_t> input, output;
+
+    /**
+     * Count of bytes of the output
+     */
+    size_t size{0};
+
+    /**
+     * xxHash64 of the block
+     */
+    uint64_t hash{0};
+
+    /**
+     * Is the block processed by a worker
+     */
+    bool done{false};
+  };
+
+  /**
+   * Archivers of the workers
+   */
+  vector<unique_ptr<blockwise>> _workers;
+
+  /**
+   * Buffers, the block with number n uses the buffer n % size
+   */
+  vector<slot> _slots;
+
+  /**
+   * Runs the pipeline until the reader stops
+   * @param read fills the buffer by the next block, returns false at the end of the input
+   * @param process processes the buffer by the worker's archiver
+   * @param write writes the processed buffer
+   */
+  void run(const function<bool(slot &)> &read,
+           const function<void(blockwise &, slot &)> &process,
+           const function<void(slot &)> &write) {
+    const uint64_t capacity = _slots.size();
+
+    mutex m;
+    condition_variable changed;
+
+    // blocks are read, taken by workers and written in order, the counters only grow
+    uint64_t readCount = 0, takenCount = 0, writtenCount = 0;
+    bool finished = false;
+    exception_ptr failure;
+
+    auto fail = [&](exception_ptr e) {
+      lock_guard<mutex> lock(m);
+      if (!failure)
+        failure = e;
+      changed.notify_all();
+    };
+
+    thread reader([&]() {
+      try {
+        for (uint64_t n = 0;; n++) {
+          {
+            unique_lock<mutex> lock(m);
+            changed.wait(lock, [&]() { return n - writtenCount < capacity || failure; });
+
+            if (failure)
+              return;
+          }
+
+          // the buffer is not used by others until it is counted as read
+          slot &s = _slots[n % capacity];
+          bool more = read(s);
+
+          lock_guard<mutex> lock(m);
+          if (more) {
+            s.done = false;
+            readCount = n + 1;
+          } else {
+            finished = true;
+          }
+          changed.notify_all();
+
+          if (!more)
+            return;
+        }
+      } catch (...) {
+        fail(current_exception());
+      }
+    });
+
+    vector<thread> workers;
+
+    for (auto &worker: _workers) {
+      blockwise &codec = *worker;
+
+      workers.emplace_back([&]() {
+        try {
+          while (true) {
+            uint64_t n;
+            {
+              unique_lock<mutex> lock(m);
+              changed.wait(lock, [&]() { return takenCount < readCount || finished || failure; });
+
+              if (failure || takenCount == readCount)
+                return;
+
+              n = takenCount++;
+            }
+
+            slot &s = _slots[n % capacity];
+            process(codec, s);
+
+            lock_guard<mutex> lock(m);
+            s.done = true;
+            changed.notify_all();
+          }
+        } catch (...) {
+          fail(current_exception());
+        }
+      });
+    }
+
+    try {
+      for (uint64_t n = 0;; n++) {
+        slot &s = _slots[n % capacity];
+        {
+          unique_lock<mutex> lock(m);
+          changed.wait(lock, [&]() { return (n < readCount && s.done) || (finished && n == readCount) || failure; });
+
+          if (failure || n == readCount)
+            break;
+        }
+
+        write(s);
+
+        lock_guard<mutex> lock(m);
+        writtenCount = n + 1;
+        changed.notify_all();
+      }
+    } catch (...) {
+      fail(current_exception());
+    }
+
+    reader.join();
+    for (auto &worker: workers)
+      worker.join();
+
+    if (failure)
+      rethrow_exception(failure);
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_PIPELINE_HPP_
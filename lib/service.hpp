@@ -0,0 +1,505 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_SERVICE_HPP_
+#define HW_ARCHIVER_LIB_SERVICE_HPP_
+
+#include "archiver.hpp"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * Bounded queue for many producers and many consumers, producers wait while it is full and consumers
+ * wait while it is empty
+ * @tparam T type of items
+ */
+template<typename T>
+class boundedqueue {
+ public:
+  /**
+   * Default constructor
+   * @param capacity maximal count of items
+   */
+  explicit boundedqueue(size_t capacity) {
+    if (capacity == 0)
+      error("Invalid queue capacity.");
+
+    _capacity = capacity;
+  }
+
+  /**
+   * Adds item to the end, waits while the queue is full
+   * @param item item
+   * @return false if the queue is closed, the item is not added then
+   */
+  bool push(T &&item) {
+    unique_lock<mutex> lock(_mutex);
+    _notFull.wait(lock, [&]() { return _items.size() < _capacity || _closed; });
+
+    if (_closed)
+      return false;
+
+    _items.push_back(move(item));
+    _maxSize = max(_maxSize, _items.size());
+    _notEmpty.notify_one();
+
+    return true;
+  }
+
+  /**
+   * Takes item from the front, waits while the queue is empty
+   * @param item taken item
+   * @return false if the queue is closed and empty
+   */
+  bool pop(T &item) {
+    unique_lock<mutex> lock(_mutex);
+    _notEmpty.wait(lock, [&]() { return !_items.empty() || _closed; });
+
+    if (_items.empty())
+      return false;
+
+    item = move(_items.front());
+    _items.pop_front();
+    _notFull.notify_one();
+
+    return true;
+  }
+
+  /**
+   * Closes the queue: pushing fails, popping takes the remaining items and then fails
+   */
+  void close() {
+    lock_guard<mutex> lock(_mutex);
+    _closed = true;
+    _notFull.notify_all();
+    _notEmpty.notify_all();
+  }
+
+  /**
+   * Returns count of items
+   * @return count of items
+   */
+  size_t size() const {
+    lock_guard<mutex> lock(_mutex);
+    return _items.size();
+  }
+
+  /**
+   * Returns the largest count of items since the queue was created
+   * @return count of items
+   */
+  size_t getMaxSize() const {
+    lock_guard<mutex> lock(_mutex);
+    return _maxSize;
+  }
+
+ private:
+  size_t _capacity;
+
+  size_t _maxSize{0};
+
+  bool _closed{false};
+
+  deque<T> _items;
+
+  mutable mutex _mutex;
+  condition_variable _notFull, _notEmpty;
+};
+
+/**
+ * Compression service: jobs with buffers or files are submitted to the bounded queue from any thread and
+ * processed by the fixed pool of workers, every worker has its own archiver, so the archivers' contexts
+ * are reused without locking. Results are returned by futures or passed to callbacks, which run on
+ * the worker's thread and must not throw. Submitting waits while the queue is full, so producers are slowed
+ * down to the speed of the workers and the memory of queued jobs is bounded. The destructor processes
+ * the queued jobs and stops the workers
+ */
+class service {
+ public:
+  /**
+   * Factory of the workers' archivers
+   */
+  typedef function<archiver *()> factory;
+
+  /**
+   * Function receiving the result of the buffer's job or the exception which failed it
+   */
+  typedef function<void(vector<uint8_t> &&result, exception_ptr failure)> callback;
+
+  /**
+   * Count of buckets of the latency histogram
+   */
+  static constexpr unsigned int LATENCY_BUCKETS = 32;
+
+  /**
+   * Counters of the service
+   */
+  struct stats {
+    /**
+     * Count of jobs waiting in the queue and the largest one
+     */
+    size_t depth;
+    size_t maxDepth;
+
+    /**
+     * Counts of submitted, completed and failed jobs
+     */
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t failed;
+
+    /**
+     * Count of bytes read and written by the completed jobs
+     */
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+
+    /**
+     * Seconds since the service was started
+     */
+    double seconds;
+
+    /**
+     * Latencies of the jobs from submitting to completion, the bucket i counts latencies
+     * from 2^i to 2^(i+1) microseconds, the first one also the shorter ones
+     */
+    array<uint64_t, LATENCY_BUCKETS> latency;
+
+    /**
+     * Returns the latency's quantile
+     * @param quantile quantile from 0 to 1
+     * @return upper bound of the quantile's bucket in microseconds, 0 if there are no jobs
+     */
+    double getLatency(double quantile) const {
+      uint64_t total = 0;
+      for (uint64_t count: latency)
+        total += count;
+
+      uint64_t rank = (uint64_t) ceil(quantile * total), seen = 0;
+
+      for (unsigned int i = 0; i < LATENCY_BUCKETS && total > 0; i++) {
+        seen += latency[i];
+
+        if (seen >= max<uint64_t>(rank, 1))
+          return (double) ((uint64_t) 1 << (i + 1));
+      }
+
+      return 0;
+    }
+
+    /**
+     * Returns throughput of the completed jobs
+     * @return read megabytes per second
+     */
+    double getThroughput() const {
+      return seconds > 0 ? bytesIn / seconds / 1e6 : 0;
+    }
+  };
+
+  /**
+   * Default constructor
+   * @param create factory of archivers
+   * @param threads count of workers, by default the count of hardware threads
+   * @param capacity maximal count of queued jobs
+   */
+  explicit service(const factory &create, unsigned int threads = 0, size_t capacity = 64)
+      : _queue(capacity), _started(clock_::now()) {
+    if (threads == 0)
+      threads = max(thread::hardware_concurrency(), 1u);
+
+    for (unsigned int i = 0; i < threads; i++)
+      _archivers.emplace_back(create());
+
+    for (auto &arch: _archivers) {
+      archiver *worker = arch.get();
+      _workers.emplace_back([this, worker]() { work(*worker); });
+    }
+  }
+
+  service(const service &) = delete;
+  service &operator=(const service &) = delete;
+
+  ~service() {
+    _queue.close();
+
+    for (auto &worker: _workers)
+      worker.join();
+  }
+
+  /**
+   * Compresses buffer
+   * @param data buffer
+   * @return future of the compressed buffer
+   */
+  future<vector<uint8_t>> compress(vector<uint8_t> data) {
+    return toFuture(data, false);
+  }
+
+  /**
+   * Decompresses buffer
+   * @param data buffer
+   * @return future of the decompressed buffer
+   */
+  future<vector<uint8_t>> decompress(vector<uint8_t> data) {
+    return toFuture(data, true);
+  }
+
+  /**
+   * Compresses buffer and passes the result to the callback
+   * @param data buffer
+   * @param done callback
+   */
+  void compress(vector<uint8_t> data, const callback &done) {
+    submitBuffer(move(data), false, done);
+  }
+
+  /**
+   * Decompresses buffer and passes the result to the callback
+   * @param data buffer
+   * @param done callback
+   */
+  void decompress(vector<uint8_t> data, const callback &done) {
+    submitBuffer(move(data), true, done);
+  }
+
+  /**
+   * Compresses file by the archiver's stream operation
+   * @param inFileName file to compress
+   * @param outFileName compressed file
+   * @return future which is ready when the file is written
+   */
+  future<void> compressFile(const string &inFileName, const string &outFileName) {
+    return submitFile(inFileName, outFileName, false);
+  }
+
+  /**
+   * Decompresses file by the archiver's stream operation
+   * @param inFileName file to decompress
+   * @param outFileName decompressed file
+   * @return future which is ready when the file is written
+   */
+  future<void> decompressFile(const string &inFileName, const string &outFileName) {
+    return submitFile(inFileName, outFileName, true);
+  }
+
+  /**
+   * Returns the current counters
+   * @return counters
+   */
+  stats getStats() const {
+    stats result{};
+    {
+      lock_guard<mutex> lock(_statsMutex);
+      result = _stats;
+    }
+
+    result.depth = _queue.size();
+    result.maxDepth = _queue.getMaxSize();
+    result.seconds = chrono::duration<double>(clock_::now() - _started).count();
+
+    return result;
+  }
+
+  /**
+   * Returns count of workers
+   * @return count of workers
+   */
+  unsigned int getThreads() const {
+    return _workers.size();
+  }
+
+ private:
+  typedef chrono::steady_clock clock_;
+
+  /**
+   * Job of the worker
+   */
+  struct job {
+    /**
+     * Runs the job by the worker's archiver, returns count of the read and written bytes
+     */
+    function<pair<uint64_t, uint64_t>(archiver &)> run;
+
+    /**
+     * Delivers the result after run, the exception which failed run or nullptr
+     */
+    function<void(exception_ptr)> finish;
+
+    clock_::time_point submitted{};
+  };
+
+  boundedqueue<job> _queue;
+
+  vector<unique_ptr<archiver>> _archivers;
+  vector<thread> _workers;
+
+  clock_::time_point _started;
+
+  mutable mutex _statsMutex;
+  stats _stats{};
+
+  /**
+   * Adds job to the queue
+   * @param j job
+   */
+  void submit(job &&j) {
+    j.submitted = clock_::now();
+
+    // counted before the push, so a worker never completes the job before it is counted
+    {
+      lock_guard<mutex> lock(_statsMutex);
+      _stats.submitted++;
+    }
+
+    if (!_queue.push(move(j))) {
+      lock_guard<mutex> lock(_statsMutex);
+      _stats.submitted--;
+
+      error("Service is stopped.");
+    }
+  }
+
+  /**
+   * Submits job of the buffer
+   * @param data buffer
+   * @param decompress true for decompression
+   * @param done callback
+   */
+  void submitBuffer(vector<uint8_t> &&data, bool decompress, const callback &done) {
+    auto input = make_shared<vector<uint8_t>>(move(data));
+    auto output = make_shared<vector<uint8_t>>();
+
+    submit({[=](archiver &arch) {
+      if (decompress) {
+        arch.decompress(*input, *output);
+      } else {
+        output->resize(arch.compressBound(input->size()));
+        output->resize(arch.compress(*input, *output));
+      }
+
+      return pair<uint64_t, uint64_t>(input->size(), output->size());
+    }, [=](exception_ptr failure) {
+      // the input is released before the callback, which may keep the result for long
+      vector<uint8_t> result = move(*output);
+      input->clear();
+      input->shrink_to_fit();
+
+      done(failure ? vector<uint8_t>() : move(result), failure);
+    }});
+  }
+
+  /**
+   * Submits job of the buffer whose result is returned by the future
+   * @param data buffer
+   * @param decompress true for decompression
+   * @return the future
+   */
+  future<vector<uint8_t>> toFuture(vector<uint8_t> &data, bool decompress) {
+    auto result = make_shared<promise<vector<uint8_t>>>();
+    future<vector<uint8_t>> ready = result->get_future();
+
+    submitBuffer(move(data), decompress, [result](vector<uint8_t> &&output, exception_ptr failure) {
+      if (failure)
+        result->set_exception(failure);
+      else
+        result->set_value(move(output));
+    });
+
+    return ready;
+  }
+
+  /**
+   * Submits job of the file, the output file is removed if the job fails
+   * @param inFileName input file
+   * @param outFileName output file
+   * @param decompress true for decompression
+   * @return future which is ready when the file is written
+   */
+  future<void> submitFile(const string &inFileName, const string &outFileName, bool decompress) {
+    auto result = make_shared<promise<void>>();
+    future<void> ready = result->get_future();
+
+    submit({[=](archiver &arch) {
+      ifstream infile(inFileName, ios::in | ios::binary);
+      if (!infile)
+        error("Cannot open " + inFileName + ".");
+
+      ofstream outfile(outFileName, ios::out | ios::binary);
+      if (!outfile)
+        error("Cannot open " + outFileName + ".");
+
+      if (decompress)
+        arch.decompress(infile, outfile);
+      else
+        arch.compress(infile, outfile);
+
+      outfile.flush();
+      if (!outfile)
+        error("Cannot write " + outFileName + ".");
+
+      infile.clear();
+
+      return pair<uint64_t, uint64_t>(infile.seekg(0, ios::end).tellg(), outfile.tellp());
+    }, [=](exception_ptr failure) {
+      if (!failure) {
+        result->set_value();
+        return;
+      }
+
+      remove(outFileName.c_str());
+      result->set_exception(failure);
+    }});
+
+    return ready;
+  }
+
+  /**
+   * Runs jobs until the queue is closed and empty
+   * @param arch the worker's archiver
+   */
+  void work(archiver &arch) {
+    job j;
+
+    while (_queue.pop(j)) {
+      pair<uint64_t, uint64_t> sizes(0, 0);
+      exception_ptr failure;
+
+      try {
+        sizes = j.run(arch);
+      } catch (...) {
+        failure = current_exception();
+      }
+
+      auto micros = chrono::duration_cast<chrono::microseconds>(clock_::now() - j.submitted).count();
+      unsigned int bits = countBits((unsigned int) min<int64_t>(micros, UINT32_MAX));
+      unsigned int bucket = min(bits > 1 ? bits - 1 : 0, LATENCY_BUCKETS - 1);
+
+      // the counters are updated before the result is delivered, so its receiver sees the job counted
+      {
+        lock_guard<mutex> lock(_statsMutex);
+
+        if (failure) {
+          _stats.failed++;
+        } else {
+          _stats.completed++;
+          _stats.bytesIn += sizes.first;
+          _stats.bytesOut += sizes.second;
+        }
+
+        _stats.latency[bucket]++;
+      }
+
+      j.finish(failure);
+    }
+  }
+};
+
+#endif //HW_ARCHIVER_LIB_SERVICE_HPP_
@@ -0,0 +1,85 @@
+//
+// Created by newap on 10/19/2026.
+//
+
+#ifndef HW_ARCHIVER_LIB_SPAN_HPP_
+#define HW_ARCHIVER_LIB_SPAN_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Non-owning view over a contiguous range of elements (minimal C++17 replacement for std::span)
+ * @tparam T element type
+ */
+template<typename T>
+class span {
+ public:
+  /**
+   * Default constructor, creates an empty view
+   */
+  constexpr span() noexcept : _data(nullptr), _size(0) {}
+
+  /**
+   * Constructor
+   * @param data pointer to the first element
+   * @param size count of elements
+   */
+  constexpr span(T *data, size_t size) noexcept : _data(data), _size(size) {}
+
+  /**
+   * Constructor from vector
+   * @tparam U vector's element type
+   * @param vec vector
+   */
+  template<typename U, typename = enable_if_t<is_convertible<U (*)[], T (*)[]>::value>>
+  span(vector<U> &vec) noexcept : _data(vec.data()), _size(vec.size()) {}
+
+  /**
+   * Constructor from constant vector
+   * @tparam U vector's element type
+   * @param vec vector
+   */
+  template<typename U, typename = enable_if_t<is_convertible<const U (*)[], T (*)[]>::value>>
+  span(const vector<U> &vec) noexcept : _data(vec.data()), _size(vec.size()) {}
+
+  /**
+   * Converting constructor (e.g. span<T> to span<const T>)
+   * @tparam U other element type
+   * @param other other view
+   */
+  template<typename U, typename = enable_if_t<is_convertible<U (*)[], T (*)[]>::value>>
+  constexpr span(const span<U> &other) noexcept : _data(other.data()), _size(other.size()) {}
+
+  constexpr T *data() const noexcept { return _data; }
+
+  constexpr size_t size() const noexcept { return _size; }
+
+  constexpr bool empty() const noexcept { return _size == 0; }
+
+  constexpr T *begin() const noexcept { return _data; }
+
+  constexpr T *end() const noexcept { return _data + _size; }
+
+  constexpr T &operator[](size_t i) const noexcept { return _data[i]; }
+
+  /**
+   * Returns view over the part of the range
+   * @param offset index of the first element
+   * @param count count of elements, by default up to the end
+   * @return view over the part of the range
+   */
+  constexpr span subspan(size_t offset, size_t count = SIZE_MAX) const noexcept {
+    return span(_data + offset, count == SIZE_MAX ? _size - offset : count);
+  }
+
+ private:
+  T *_data;
+  size_t _size;
+};
+
+#endif //HW_ARCHIVER_LIB_SPAN_HPP_
@@ -74,6 +74,83 @@ struct compare {
   }
 };
 
+/**
+ * Huffman tree packed to one array in breadth-first order, so the upper levels share cache lines.
+ * Internal node is a pair of 16-bit entries for its '0' and '1' children, every entry is the index of
+ * the child's pair or LEAF | character for leaves. The whole tree takes 1 KB
+ */
+struct FlatTree {
+  /**
+   * Flag of leaf entries
+   */
+  static constexpr uint16_t LEAF = 0x8000;
+
+  /**
+   * Entry of the root
+   */
+  uint16_t root;
+
+  /**
+   * Children of internal nodes, node i has entries 2 * i and 2 * i + 1
+   */
+  uint16_t children[2 * MAX_CHAR];
+
+  /**
+   * Count of internal nodes
+   */
+  int size;
+
+  /**
+   * Packs the tree
+   * @param tree root of the tree with at most MAX_CHAR + 1 leaves
+   */
+  void build(const Node *tree) {
+    // internal nodes in the order of their indices
+    const Node *queue[MAX_CHAR];
+    size = 0;
+    root = pack(tree, queue);
+
+    for (int i = 0; i < size; i++) {
+      children[2 * i] = pack(queue[i]->zero, queue);
+      children[2 * i + 1] = pack(queue[i]->one, queue);
+    }
+  }
+
+  /**
+   * Returns entry of the child
+   * @param entry entry of internal node
+   * @param bit bit of the code
+   * @return entry of the child
+   */
+  uint16_t child(uint16_t entry, int bit) const {
+    return children[2 * entry + bit];
+  }
+
+  static bool isLeaf(uint16_t entry) {
+    return entry & LEAF;
+  }
+
+  static ext_char character(uint16_t entry) {
+    return entry & ~LEAF;
+  }
+
+ private:
+  /**
+   * Returns entry of the node, internal nodes are added to the queue
+   * @param node node
+   * @param queue queue of internal nodes
+   * @return the entry
+   */
+  uint16_t pack(const Node *node, const Node **queue) {
+    if (node->character != NOT_A_CHAR)
+      return LEAF | node->character;
+
+    queue[size] = node;
+
+    return size++;
+  }
+};
+
 /**
  * Structure for stroing LZ77 results
  */
@@ -7,13 +7,14 @@
 
 #include <string>
 #include <stdexcept>
+#include <cstdint>
 using namespace std;
 
 /**
  * Throws exception with message
  * @param msg message
  */
-static void error(const string &msg) {
+[[noreturn]] static void error(const string &msg) {
   throw runtime_error(msg);
 }
 
@@ -47,4 +48,46 @@ static uint64_t combineNumber(uint64_t j, uint64_t k, uint8_t c, const unsigned
   return res;
 }
 
+/**
+ * Returns mask with the lowest n bits set
+ * @param n count of bits
+ * @return mask
+ */
+static constexpr uint64_t lowMask(unsigned int n) {
+  return n >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << n) - 1;
+}
+
+/**
+ * Reverses the order of the lowest n bits of the value
+ * @param value value
+ * @param n count of bits
+ * @return value with reversed bits
+ */
+static inline uint64_t reverseBits(uint64_t value, unsigned int n) {
+  if (n == 0)
+    return 0;
+
+  value = ((value >> 1) & 0x5555555555555555ULL) | ((value & 0x5555555555555555ULL) << 1);
+  value = ((value >> 2) & 0x3333333333333333ULL) | ((value & 0x3333333333333333ULL) << 2);
+  value = ((value >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((value & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  value = ((value >> 8) & 0x00FF00FF00FF00FFULL) | ((value & 0x00FF00FF00FF00FFULL) << 8);
+  value = ((value >> 16) & 0x0000FFFF0000FFFFULL) | ((value & 0x0000FFFF0000FFFFULL) << 16);
+  value = (value >> 32) | (value << 32);
+
+  return value >> (64 - n);
+}
+
+/**
+ * Converts value loaded from memory to little endian order
+ * @param value value
+ * @return value in little endian order
+ */
+static inline uint64_t toLittleEndian(uint64_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return __builtin_bswap64(value);
+#else
+  return value;
+#endif
+}
+
 #endif //HW_ARCHIVER_LIB_UTILS_H_
@@ -0,0 +1,531 @@
+//
+// Created by newap on 10/19/2026.
+//
+// Command-line compressor: compresses and decompresses files or pipes in the container format, tests
+// archives without writing them and benchmarks codecs in memory. Frame archives take new data by appending
+// frames, so increments are compressed without recompressing the archive. Input and output are stdin and stdout
+// if they are omitted or "-", so it works in shell pipelines in place of gzip. All allocations of the program
+// are counted, so the peak memory of every operation is reported
+//
+
+#define HW_ARCHIVER_TRACK_MEMORY
+
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include "../lib/container.hpp"
+#include "../lib/frames.hpp"
+#include "../lib/memtrack.hpp"
+#include "../lib/timer.hpp"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace std;
+
+/**
+ * Count of runs of every benchmark, the fastest one is reported
+ */
+const int BENCH_RUNS = 3;
+
+/**
+ * Count of bytes in megabyte
+ */
+const size_t MEGABYTE = 1 << 20;
+
+const char *const USAGE =
+    "Usage: hwarc <command> [options] [input [output]]\n"
+    "\n"
+    "Commands:\n"
+    "  compress, c     compress input to output\n"
+    "  decompress, d   decompress input to output\n"
+    "  test, t         decompress input and check it without writing\n"
+    "  verify, v       decompress input and compare it with the original or print its checksum\n"
+    "                  without writing: input [original]\n"
+    "  bench, b        compress and decompress input files in memory, print ratio and speed\n"
+    "  append, a       append input as a new frame to the frame archive: [input] archive\n"
+    "  extract, x      decompress frames of the frame archive: archive [output]\n"
+    "  list, l         print frames of the frame archive: archive\n"
+    "\n"
+    "Options:\n"
+    "  -1 ... -19      compression level (default 6)\n"
+    "  -m codec[:p...] codec and its parameters instead of the level: huff, huff4, huffctx[:groups],\n"
+    "                  lz77[:window:lookahead:depth], lz77long[:window:lookahead:depth:parse],\n"
+    "                  lzw[:bits], auto, bwt[:block], level[:level], dedup[:chunkbits:level]\n"
+    "  -T n            count of threads of lz77long, auto, bwt, level and dedup, 0 for all hardware threads\n"
+    "                  (default 1)\n"
+    "  -M n            memory budget of compression levels in megabytes, threads, window and blocks\n"
+    "                  are reduced to fit it (default no limit)\n"
+    "  -v              print peak memory of the operation, bench also the selected kernels\n"
+    "  -p              append the frame referencing the previous frame (lz77, lz77long, lzw)\n"
+    "  -L n            extract only the last n frames\n"
+    "  -h              print this help\n"
+    "\n"
+    "Input and output are stdin and stdout if they are omitted or \"-\".\n"
+    "HW_ARCHIVER_CPU=baseline|sse4.2|avx2 limits the kernels to the instruction set.\n";
+
+/**
+ * Options of the command line
+ */
+struct options {
+    string command;
+
+    container::codecs codec = container::LEVEL;
+
+    vector<uint32_t> params;
+
+    unsigned int threads = 1;
+
+    /**
+     * Memory budget in bytes, 0 for no limit
+     */
+    size_t budget = 0;
+
+    bool verbose = false;
+
+    /**
+     * Is the appended frame primed by the previous one
+     */
+    bool primed = false;
+
+    /**
+     * Count of the last frames to extract, 0 for all
+     */
+    size_t lastFrames = 0;
+
+    vector<string> files;
+};
+
+/**
+ * Stream buffer which discards everything written to it and counts bytes
+ */
+class nullbuf : public streambuf {
+ public:
+    /**
+     * Count of written bytes
+     */
+    uint64_t count = 0;
+
+ protected:
+    int overflow(int ch) override {
+        count++;
+        return ch == EOF ? 0 : ch;
+    }
+
+    streamsize xsputn(const char *, streamsize n) override {
+        count += n;
+        return n;
+    }
+};
+
+/**
+ * Parses unsigned number
+ * @param s string
+ * @return the number
+ */
+uint32_t parseNumber(const string &s) {
+    if (s.empty() || s.find_first_not_of("0123456789") != string::npos || s.size() > 10)
+        error("Invalid number " + s + ".");
+
+    uint64_t value = stoull(s);
+
+    if (value > UINT32_MAX)
+        error("Invalid number " + s + ".");
+
+    return value;
+}
+
+/**
+ * Parses the command line
+ * @param argc count of arguments
+ * @param argv arguments
+ * @return options
+ */
+options parseOptions(int argc, char **argv) {
+    options opts;
+
+    if (argc < 2)
+        error("No command given.");
+
+    opts.command = argv[1];
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+
+        if (arg.size() < 2 || arg[0] != '-') {
+            opts.files.push_back(arg);
+        } else if (isdigit(arg[1])) {
+            opts.codec = container::LEVEL;
+            opts.params = {parseNumber(arg.substr(1))};
+        } else if (arg == "-m" && i + 1 < argc) {
+            string spec = argv[++i];
+            size_t pos = spec.find(':');
+
+            opts.codec = container::getCodec(spec.substr(0, pos));
+            opts.params.clear();
+
+            while (pos != string::npos) {
+                size_t next = spec.find(':', pos + 1);
+                opts.params.push_back(parseNumber(spec.substr(pos + 1, next - pos - 1)));
+                pos = next;
+            }
+        } else if (arg == "-h") {
+            opts.command = "help";
+        } else if (arg == "-T" && i + 1 < argc) {
+            opts.threads = parseNumber(argv[++i]);
+
+            if (opts.threads == 0)
+                opts.threads = max(thread::hardware_concurrency(), 1u);
+        } else if (arg == "-M" && i + 1 < argc) {
+            opts.budget = parseNumber(argv[++i]) * MEGABYTE;
+
+            if (opts.budget == 0)
+                error("Invalid memory budget.");
+        } else if (arg == "-v") {
+            opts.verbose = true;
+        } else if (arg == "-p") {
+            opts.primed = true;
+        } else if (arg == "-L" && i + 1 < argc) {
+            opts.lastFrames = parseNumber(argv[++i]);
+        } else {
+            error("Unknown option " + arg + ".");
+        }
+    }
+
+    return opts;
+}
+
+/**
+ * Opens input file or stdin
+ * @param name filename or "-"
+ * @param file file stream
+ * @return the input stream
+ */
+istream &openInput(const string &name, ifstream &file) {
+    if (name == "-")
+        return cin;
+
+    file.open(name, ios::in | ios::binary);
+
+    if (!file)
+        error("Cannot open " + name + ".");
+
+    return file;
+}
+
+/**
+ * Returns peak memory of the operation started by memtrack::reset
+ * @param base count of bytes allocated before the operation
+ * @return peak memory above the base in megabytes
+ */
+double getPeakMemory(size_t base) {
+    return (double) (memtrack::peak - base) / MEGABYTE;
+}
+
+/**
+ * Compresses or decompresses input to output, the output file is removed if it fails
+ * @param opts options
+ * @param decompress true for decompression
+ */
+void run(const options &opts, bool decompress) {
+    if (opts.files.size() > 2)
+        error("Too many files given.");
+
+    string input = opts.files.size() > 0 ? opts.files[0] : "-";
+    string output = opts.files.size() > 1 ? opts.files[1] : "-";
+
+    size_t base = memtrack::reset();
+    container arch(opts.codec, opts.params, opts.threads, opts.budget);
+
+    ifstream infile;
+    istream &in = openInput(input, infile);
+
+    ofstream outfile;
+    if (output != "-") {
+        outfile.open(output, ios::out | ios::binary);
+
+        if (!outfile)
+            error("Cannot open " + output + ".");
+    }
+
+    ostream &out = output == "-" ? cout : outfile;
+
+    try {
+        if (decompress)
+            arch.decompress(in, out);
+        else
+            arch.compress(in, out);
+
+        out.flush();
+
+        if (!out)
+            error("Cannot write " + output + ".");
+
+        if (opts.verbose)
+            cerr << input << ": peak memory " << fixed << setprecision(1) << getPeakMemory(base) << " MB" << endl;
+    } catch (...) {
+        if (output != "-") {
+            outfile.close();
+            remove(output.c_str());
+        }
+
+        throw;
+    }
+}
+
+/**
+ * Decompresses input without writing it, streams of the blockwise codecs are checked by their checksums
+ * @param opts options
+ */
+void test(const options &opts) {
+    vector<string> files = opts.files.empty() ? vector<string>{"-"} : opts.files;
+    container arch(opts.codec, opts.params, opts.threads, opts.budget);
+
+    for (const auto &name: files) {
+        ifstream infile;
+        istream &in = openInput(name, infile);
+
+        nullbuf sink;
+        ostream out(&sink);
+
+        size_t base = memtrack::reset();
+        arch.decompress(in, out);
+
+        cerr << name << ": OK, " << sink.count << " bytes";
+
+        if (opts.verbose)
+            cerr << ", peak memory " << fixed << setprecision(1) << getPeakMemory(base) << " MB";
+
+        cerr << endl;
+    }
+}
+
+/**
+ * Decompresses input through the rolling window of the decoder without writing it and compares it with
+ * the original, without the original prints the size and xxHash64 checksum of the decompressed contents
+ * @param opts options
+ */
+void verify(const options &opts) {
+    if (opts.files.empty() || opts.files.size() > 2)
+        error("Verify takes input [original].");
+
+    container arch(opts.codec, opts.params, opts.threads, opts.budget);
+
+    ifstream infile, originalFile;
+    istream &in = openInput(opts.files[0], infile);
+
+    if (opts.files.size() > 1) {
+        originalFile.open(opts.files[1], ios::in | ios::binary);
+
+        if (!originalFile)
+            error("Cannot open " + opts.files[1] + ".");
+    }
+
+    verifybuf sink(opts.files.size() > 1 ? &originalFile : nullptr);
+    ostream out(&sink);
+
+    size_t base = memtrack::reset();
+    arch.decompress(in, out);
+
+    if (opts.files.size() > 1 && !sink.matches())
+        error(opts.files[0] + " differs from " + opts.files[1] + ".");
+
+    cerr << opts.files[0] << ": OK, " << sink.getSize() << " bytes, xxhash64 " << hex << setw(16) << setfill('0')
+         << sink.getChecksum() << dec;
+
+    if (opts.verbose)
+        cerr << ", peak memory " << fixed << setprecision(1) << getPeakMemory(base) << " MB";
+
+    cerr << endl;
+}
+
+/**
+ * Compresses and decompresses input files in memory and prints ratio and speed of the fastest runs
+ * @param opts options
+ */
+void bench(const options &opts) {
+    vector<string> files = opts.files.empty() ? vector<string>{"-"} : opts.files;
+    container arch(opts.codec, opts.params, opts.threads, opts.budget);
+    Timer timer;
+
+    size_t totalIn = 0, totalOut = 0;
+    double totalCompress = 0, totalDecompress = 0, totalPeak = 0;
+
+    if (opts.verbose)
+        cerr << "kernels " << cpu::getName(cpu::selected) << endl;
+
+    for (const auto &name: files) {
+        ifstream infile;
+        vector<uint8_t> contents = arch.getContents(openInput(name, infile));
+        vector<uint8_t> compressed(arch.compressBound(contents.size())), decompressed;
+
+        double compressTime = 0, decompressTime = 0;
+        size_t size = 0;
+
+        // the peak includes the decompressed buffer, the input and the compressed buffers are allocated before
+        size_t base = memtrack::reset();
+
+        for (int k = 0; k < BENCH_RUNS; k++) {
+            timer.reset();
+            size = arch.compress(contents, compressed);
+            double elapsed = timer.elapsed();
+            compressTime = k == 0 ? elapsed : min(compressTime, elapsed);
+
+            decompressed.clear();
+            timer.reset();
+            arch.decompress(span<const uint8_t>(compressed.data(), size), decompressed);
+            elapsed = timer.elapsed();
+            decompressTime = k == 0 ? elapsed : min(decompressTime, elapsed);
+        }
+
+        double peak = getPeakMemory(base);
+
+        if (!arch.compareFiles(contents, decompressed))
+            error(name + ": decompressed data differs.");
+
+        printf("%-24s %12zu -> %12zu  ratio %6.3f  compress %8.1f MB/s  decompress %8.1f MB/s  memory %7.1f MB\n",
+               name.c_str(), contents.size(), size, (double) contents.size() / max<size_t>(size, 1),
+               contents.size() / (compressTime + 1) * 1e3, contents.size() / (decompressTime + 1) * 1e3, peak);
+
+        totalIn += contents.size();
+        totalOut += size;
+        totalCompress += compressTime;
+        totalDecompress += decompressTime;
+        totalPeak = max(totalPeak, peak);
+    }
+
+    if (files.size() > 1)
+        printf("%-24s %12zu -> %12zu  ratio %6.3f  compress %8.1f MB/s  decompress %8.1f MB/s  memory %7.1f MB\n",
+               "total", totalIn, totalOut, (double) totalIn / max<size_t>(totalOut, 1),
+               totalIn / (totalCompress + 1) * 1e3, totalIn / (totalDecompress + 1) * 1e3, totalPeak);
+}
+
+/**
+ * Appends input as the new frame of the frame archive, which is created if it does not exist
+ * @param opts options
+ */
+void append(const options &opts) {
+    if (opts.files.empty() || opts.files.size() > 2)
+        error("Append takes [input] archive.");
+
+    string input = opts.files.size() > 1 ? opts.files[0] : "-";
+    container arch(opts.codec, opts.params, opts.threads, opts.budget);
+
+    ifstream infile;
+    vector<uint8_t> contents = arch.getContents(openInput(input, infile));
+
+    frames archive(opts.files.back(), true);
+    archive.append(contents, arch, opts.primed);
+
+    if (opts.verbose) {
+        const frames::frame &f = archive.getFrames().back();
+        cerr << input << ": frame " << archive.getFrames().size() - 1 << ", " << f.size << " -> "
+             << f.payloadSize << " bytes" << endl;
+    }
+}
+
+/**
+ * Decompresses frames of the frame archive to output
+ * @param opts options
+ */
+void extract(const options &opts) {
+    if (opts.files.empty() || opts.files.size() > 2)
+        error("Extract takes archive [output].");
+
+    string output = opts.files.size() > 1 ? opts.files[1] : "-";
+    frames archive(opts.files[0]);
+
+    size_t count = archive.getFrames().size();
+    size_t first = opts.lastFrames > 0 && opts.lastFrames < count ? count - opts.lastFrames : 0;
+
+    ofstream outfile;
+    if (output != "-") {
+        outfile.open(output, ios::out | ios::binary);
+
+        if (!outfile)
+            error("Cannot open " + output + ".");
+    }
+
+    ostream &out = output == "-" ? cout : outfile;
+
+    try {
+        archive.extract(first, out);
+        out.flush();
+
+        if (!out)
+            error("Cannot write " + output + ".");
+    } catch (...) {
+        if (output != "-") {
+            outfile.close();
+            remove(output.c_str());
+        }
+
+        throw;
+    }
+}
+
+/**
+ * Prints frames of the frame archive
+ * @param opts options
+ */
+void list(const options &opts) {
+    if (opts.files.size() != 1)
+        error("List takes archive.");
+
+    frames archive(opts.files[0]);
+    const vector<frames::frame> &all = archive.getFrames();
+
+    printf("%6s %14s %14s %12s %12s %10s\n", "frame", "offset", "position", "size", "compressed", "history");
+
+    for (size_t i = 0; i < all.size(); i++)
+        printf("%6zu %14llu %14llu %12llu %12llu %10u\n", i, (unsigned long long) all[i].offset,
+               (unsigned long long) all[i].position, (unsigned long long) all[i].size,
+               (unsigned long long) all[i].payloadSize, all[i].history);
+}
+
+/**
+ * Main entry point
+ * @param argc count of arguments
+ * @param argv arguments
+ * @return exit code
+ */
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    ios::sync_with_stdio(false);
+
+    try {
+        options opts = parseOptions(argc, argv);
+
+        if (opts.command == "compress" || opts.command == "c")
+            run(opts, false);
+        else if (opts.command == "decompress" || opts.command == "d")
+            run(opts, true);
+        else if (opts.command == "test" || opts.command == "t")
+            test(opts);
+        else if (opts.command == "verify" || opts.command == "v")
+            verify(opts);
+        else if (opts.command == "bench" || opts.command == "b")
+            bench(opts);
+        else if (opts.command == "append" || opts.command == "a")
+            append(opts);
+        else if (opts.command == "extract" || opts.command == "x")
+            extract(opts);
+        else if (opts.command == "list" || opts.command == "l")
+            list(opts);
+        else if (opts.command == "help" || opts.command == "-h")
+            cout << USAGE;
+        else
+            error("Unknown command " + opts.command + ".");
+    } catch (const exception &e) {
+        cerr << "hwarc: " << e.what() << endl << "Try 'hwarc -h' for help." << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -5,14 +5,34 @@
 // Cостав исходных файлов:
 //
 // src/main.cpp
+// src/cli.cpp
+// lib/span.hpp
 // lib/bitbuf.hpp
 // lib/timer.hpp
 // lib/types.h
 // lib/utils.h
+// lib/checksum.hpp
+// lib/cpu.hpp
 // lib/archiver.hpp
 // lib/huffman.hpp
+// lib/ctxhuffman.hpp
 // lib/lz77.hpp
+// lib/lz77long.hpp
 // lib/lzw.hpp
+// lib/dedup.hpp
+// lib/blockwise.hpp
+// lib/autoarchiver.hpp
+// lib/pipeline.hpp
+// lib/bwt.hpp
+// lib/filter.hpp
+// lib/levels.hpp
+// lib/container.hpp
+// lib/memtrack.hpp
+// lib/service.hpp
+// lib/frames.hpp
+// fuzz/fuzz_decompress.cpp
+// bench/bench_kernels.cpp
+// bench/load_service.cpp
 //
 // Реализованы следуюшие функции:
 //
@@ -25,9 +45,17 @@
 
 #include <iostream>
 #include "../lib/archiver.hpp"
+#include "../lib/autoarchiver.hpp"
+#include "../lib/bwt.hpp"
+#include "../lib/ctxhuffman.hpp"
+#include "../lib/dedup.hpp"
+#include "../lib/filter.hpp"
 #include "../lib/huffman.hpp"
+#include "../lib/levels.hpp"
 #include "../lib/lz77.hpp"
+#include "../lib/lz77long.hpp"
 #include "../lib/lzw.hpp"
+#include "../lib/pipeline.hpp"
 #include "../lib/timer.hpp"
 
 using namespace std;
@@ -43,7 +71,6 @@ const unsigned int KB = 1024;
 const string DATA_PATH = "..\\DATA\\";
 const string ORIGINAL_PATH = DATA_PATH + "original\\";
 const string COMPRESSED_PATH = DATA_PATH + "compressed\\";
-const string UNCOMPRESSED_PATH = DATA_PATH + "uncompressed\\";
 const string RESULTS_PATH = DATA_PATH + "results\\";
 
 /**
@@ -54,10 +81,22 @@ vector<archiver *> getArchivers() {
     vector<archiver *> archivers;
 
     archivers.push_back(new huffman());
-    archivers.push_back(new lz77<4 * KB, KB>());
-    archivers.push_back(new lz77<8 * KB, 2 * KB>());
-    archivers.push_back(new lz77<16 * KB, 4 * KB>());
+    archivers.push_back(new huffman(true));
+    archivers.push_back(new ctxhuffman());
+    archivers.push_back(new lz77dyn(4 * KB, KB));
+    archivers.push_back(new lz77dyn(8 * KB, 2 * KB));
+    archivers.push_back(new lz77dyn(16 * KB, 4 * KB));
+    archivers.push_back(new lz77long(64 * KB * KB));
     archivers.push_back(new lzw(16));
+    archivers.push_back(new autoarchiver());
+    archivers.push_back(new pipeline([]() { return new autoarchiver(); }));
+    archivers.push_back(new pipeline([]() { return new blockwise(new bwt()); }));
+    archivers.push_back(new filter(new lz77dyn(16 * KB, 4 * KB)));
+    archivers.push_back(new filter(new lzw(16)));
+    archivers.push_back(new levels(levels::MIN_LEVEL));
+    archivers.push_back(new levels(levels::DEFAULT_LEVEL));
+    archivers.push_back(new levels(levels::MAX_LEVEL));
+    archivers.push_back(new dedup(new levels(levels::DEFAULT_LEVEL)));
 
     return archivers;
 }
@@ -75,30 +114,26 @@ vector<string> getCompressedEndings() {
     vector<string> compressedEndings;
 
     compressedEndings.emplace_back("haff");
+    compressedEndings.emplace_back("haff4");
+    compressedEndings.emplace_back("haffctx");
     compressedEndings.emplace_back("lz775");
     compressedEndings.emplace_back("lz7710");
     compressedEndings.emplace_back("lz7720");
+    compressedEndings.emplace_back("lz77l");
     compressedEndings.emplace_back("lzw");
+    compressedEndings.emplace_back("auto");
+    compressedEndings.emplace_back("pauto");
+    compressedEndings.emplace_back("bwt");
+    compressedEndings.emplace_back("flz7720");
+    compressedEndings.emplace_back("flzw");
+    compressedEndings.emplace_back("lv1");
+    compressedEndings.emplace_back("lv6");
+    compressedEndings.emplace_back("lv19");
+    compressedEndings.emplace_back("dlv6");
 
     return compressedEndings;
 }
 
-/**
- * Gets and returns endings for decompression
- * @return endings for decompression
- */
-vector<string> getUncompressedEndings() {
-    vector<string> uncompressedEndings;
-
-    uncompressedEndings.emplace_back("unhaff");
-    uncompressedEndings.emplace_back("unlz775");
-    uncompressedEndings.emplace_back("unlz7710");
-    uncompressedEndings.emplace_back("unlz7720");
-    uncompressedEndings.emplace_back("unlzw");
-
-    return uncompressedEndings;
-}
-
 /**
  * Gets and returns data filenames
  * @return data filenames
@@ -161,14 +196,12 @@ void setupFileDetails(const vector<string> &dataFileNames) {
  * Starts the experiment
  * @param archivers archivers
  * @param compressedEndings endings for compression
- * @param uncompressedEndings endings for decompression
  * @param dataFileNames filenames
  * @param MEASURES_COUNT measures count
  * @param IGNORED_MEASURES_COUNT ignored measures count
  */
 void startExperiment(const vector<archiver *> &archivers,
                      const vector<string> &compressedEndings,
-                     const vector<string> &uncompressedEndings,
                      const vector<string> &dataFileNames,
                      const int MEASURES_COUNT,
                      const int IGNORED_MEASURES_COUNT) {
@@ -194,25 +227,26 @@ void startExperiment(const vector<archiver *> &archivers,
         for (int j = 0; j < FILES_COUNT; j++) {
             string originalFilePath = ORIGINAL_PATH + dataFileNames[j];
             string compressedFilePath = COMPRESSED_PATH + dataFileNames[j] + "." + compressedEndings[i];
-            string uncompressedFilePath = UNCOMPRESSED_PATH + dataFileNames[j] + "." + uncompressedEndings[i];
 
             cout << "File: " << j + 1 << " was loaded" << endl;
 
             double compressTime = 0, decompressTime = 0;
+            bool matches = true;
 
             // ignoring results
             for (int k = 0; k < IGNORED_MEASURES_COUNT; k++) {
                 arch->compress(originalFilePath, compressedFilePath);
-                arch->decompress(compressedFilePath, uncompressedFilePath);
+                arch->verify(compressedFilePath, originalFilePath);
             }
 
+            // decompression is timed by verify, which compares with the original without writing the output
             for (int k = 0; k < MEASURES_COUNT; k++) {
                 timer.reset();
                 arch->compress(originalFilePath, compressedFilePath);
                 compressTime += timer.elapsed();
 
                 timer.reset();
-                arch->decompress(compressedFilePath, uncompressedFilePath);
+                matches = arch->verify(compressedFilePath, originalFilePath) && matches;
                 decompressTime += timer.elapsed();
             }
 
@@ -221,8 +255,7 @@ void startExperiment(const vector<archiver *> &archivers,
 
             ftime << compressTime << " " << decompressTime << endl;
             fsize << arch->getSize(compressedFilePath) << endl;
-            fmatch << (arch->compareFiles(arch->getContents(originalFilePath),
-                                          arch->getContents(uncompressedFilePath)) ? "Matches" : "Differs") << endl;
+            fmatch << (matches ? "Matches" : "Differs") << endl;
         }
 
         ftime.close();
@@ -239,11 +272,10 @@ int main() {
     vector<archiver *> archivers = getArchivers();
 
     vector<string> compressedEndings = getCompressedEndings();
-    vector<string> uncompressedEndings = getUncompressedEndings();
     vector<string> dataFileNames = getDatFileNames();
 
     setupFileDetails(dataFileNames);
-    startExperiment(archivers, compressedEndings, uncompressedEndings, dataFileNames, 20, 10);
+    startExperiment(archivers, compressedEndings, dataFileNames, 20, 10);
 
     freeArchivers(archivers);
     return 0;
@@ -0,0 +1,118 @@
+//
+// Created by newap on 10/19/2026.
+//
+// Regression tests of the frame archive: the index of several frames is loaded without reading the frames' headers,
+// the chains of primed frames are bounded
+//
+
+#include <cstdio>
+#include <iostream>
+#include "../lib/frames.hpp"
+
+using namespace std;
+
+/**
+ * Reports the failed check
+ * @param ok result of the check
+ * @param message description of the check
+ * @return ok
+ */
+bool check(bool ok, const string &message) {
+    if (!ok)
+        cerr << "FAILED: " << message << endl;
+
+    return ok;
+}
+
+/**
+ * Returns the contents of the frame
+ * @param index index of the frame
+ * @return lines of text
+ */
+vector<uint8_t> makeContents(int index) {
+    string text;
+    for (int j = 0; j < 1000; j++)
+        text += "frame " + to_string(index) + " line " + to_string(j) + "\n";
+
+    return vector<uint8_t>(text.begin(), text.end());
+}
+
+/**
+ * Opens the archive of three frames whose first header is damaged, only the index finds the frames
+ */
+bool testIndexOnly(const string &fileName) {
+    vector<vector<uint8_t>> contents;
+
+    for (int i = 0; i < 3; i++)
+        contents.push_back(makeContents(i));
+
+    remove(fileName.c_str());
+
+    {
+        container arch(container::LEVEL, {3});
+        frames archive(fileName, true);
+
+        for (const vector<uint8_t> &data : contents)
+            archive.append(data, arch);
+    }
+
+    // the recovery scan stops at the first header, so the archive opens only through the index
+    {
+        fstream file(fileName, ios::in | ios::out | ios::binary);
+        file.write("XXXX", frames::MAGIC_SIZE);
+    }
+
+    frames archive(fileName);
+    const vector<frames::frame> &all = archive.getFrames();
+    bool ok = check(all.size() == contents.size(), "count of frames loaded from the index");
+
+    for (size_t i = 1; ok && i < all.size(); i++) {
+        vector<uint8_t> out;
+        archive.read(i, out);
+
+        ok = check(out == contents[i], "contents of frame " + to_string(i));
+    }
+
+    remove(fileName.c_str());
+
+    return ok;
+}
+
+/**
+ * Appends primed frames, every MAX_CHAIN-th frame is decompressed alone
+ */
+bool testChain(const string &fileName) {
+    remove(fileName.c_str());
+
+    container arch(container::LZW);
+    frames archive(fileName, true);
+    size_t count = frames::MAX_CHAIN * 2 + 1;
+
+    for (size_t i = 0; i < count; i++)
+        archive.append(makeContents((int) i), arch, true);
+
+    bool ok = true;
+
+    for (size_t i = 0; ok && i < count; i++) {
+        const frames::frame &f = archive.getFrames()[i];
+        ok = check((f.history == 0) == (i % frames::MAX_CHAIN == 0), "history of frame " + to_string(i));
+
+        vector<uint8_t> out;
+        archive.read(i, out);
+
+        ok = ok && check(out == makeContents((int) i), "contents of frame " + to_string(i));
+    }
+
+    remove(fileName.c_str());
+
+    return ok;
+}
+
+int main() {
+    bool ok = testIndexOnly("test_frames.hwar");
+    ok = testChain("test_frames.hwar") && ok;
+
+    cout << (ok ? "OK" : "FAILED") << endl;
+
+    return ok ? 0 : 1;
+}